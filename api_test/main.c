@@ -864,6 +864,22 @@ static void line_endings(test_batch_runner *runner) {
          "crlf endings with CMARK_OPT_NOBREAKS");
   free(html);
 
+  // Line endings and NULs past the first vector-width of a line.
+  static const char long_lines[] =
+      "a long first line that runs well past thirty-two bytes\r"
+      "a long second line that runs well past thirty-two bytes\r\n"
+      "a long third line with a NUL \0 past sixteen bytes\n"
+      "a long fourth line that runs well past thirty-two bytes";
+  html = cmark_markdown_to_html(long_lines, sizeof(long_lines) - 1,
+                                CMARK_OPT_DEFAULT | CMARK_OPT_HARDBREAKS);
+  STR_EQ(runner, html,
+         "<p>a long first line that runs well past thirty-two bytes<br />\n"
+         "a long second line that runs well past thirty-two bytes<br />\n"
+         "a long third line with a NUL " UTF8_REPL " past sixteen bytes<br />\n"
+         "a long fourth line that runs well past thirty-two bytes</p>\n",
+         "long lines with mixed endings and NUL");
+  free(html);
+
   static const char no_line_ending[] = "```\nline\n```";
   html = cmark_markdown_to_html(no_line_ending, sizeof(no_line_ending) - 1,
                                 CMARK_OPT_DEFAULT);
@@ -1105,6 +1121,118 @@ static void source_pos_inlines(test_batch_runner *runner) {
   }
 }
 
+static void arena(test_batch_runner *runner) {
+  static const char markdown[] = "# Title\n"
+                                 "\n"
+                                 "Some *emphasis* and a [link][ref].\n"
+                                 "\n"
+                                 "[ref]: /url\n";
+  cmark_arena_stats stats;
+  cmark_arena *arena = cmark_arena_new();
+  cmark_arena *prev = cmark_arena_set_current(arena);
+
+  cmark_arena_get_stats(arena, &stats);
+  INT_EQ(runner, (int)stats.chunks, 0, "new arena holds no chunks");
+
+  for (int i = 0; i < 3; ++i) {
+    cmark_parser *parser = cmark_parser_new_with_mem(
+        CMARK_OPT_DEFAULT, cmark_get_arena_mem_allocator());
+    cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+    cmark_node *doc = cmark_parser_finish(parser);
+    char *html = cmark_render_html_with_mem(doc, CMARK_OPT_DEFAULT, NULL,
+                                            cmark_get_arena_mem_allocator());
+    STR_EQ(runner, html,
+           "<h1>Title</h1>\n"
+           "<p>Some <em>emphasis</em> and a <a href=\"/url\">link</a>.</p>\n",
+           "render from arena, pass %d", i);
+
+    cmark_arena_get_stats(arena, &stats);
+    OK(runner, stats.chunks >= 1 && stats.used > 0 &&
+               stats.used <= stats.capacity,
+       "arena stats track usage, pass %d", i);
+
+    cmark_arena_clear(arena);
+    cmark_arena_get_stats(arena, &stats);
+    INT_EQ(runner, (int)stats.chunks, 1, "clear retains one chunk, pass %d", i);
+    INT_EQ(runner, (int)stats.used, 0, "clear rewinds usage, pass %d", i);
+  }
+
+  // Growing the most recent allocation extends it in place.
+  cmark_mem *mem = cmark_get_arena_mem_allocator();
+  char *grown = (char *)mem->realloc(NULL, 16);
+  memcpy(grown, "in place", 9);
+  for (size_t sz = 32; sz <= 4096; sz *= 2) {
+    char *p = (char *)mem->realloc(grown, sz);
+    OK(runner, p == grown, "realloc to %d stays in place", (int)sz);
+    grown = p;
+  }
+  STR_EQ(runner, grown, "in place", "in-place realloc keeps contents");
+  mem->calloc(1, 8);
+  char *moved = (char *)mem->realloc(grown, 8192);
+  OK(runner, moved != grown, "realloc of an older block moves it");
+  STR_EQ(runner, moved, "in place", "moved realloc keeps contents");
+  cmark_arena_get_stats(arena, &stats);
+  INT_EQ(runner, (int)stats.wasted, 4096 + (int)sizeof(size_t),
+         "moved realloc is counted as waste");
+  cmark_arena_clear(arena);
+
+  // A one-off spike is retained at first, then trimmed once smaller
+  // documents have pulled the high-water mark back down.
+  const size_t spike = 32 * 1048576;
+  char *big = (char *)mem->calloc(1, spike);
+  OK(runner, big[0] == 0 && big[spike - 1] == 0, "spike is zeroed");
+  cmark_arena_clear(arena);
+  cmark_arena_get_stats(arena, &stats);
+  OK(runner, stats.capacity >= spike, "spike capacity is retained");
+  OK(runner, stats.high_water >= spike, "high-water mark follows spike");
+
+  for (int i = 0; i < 10; ++i) {
+    mem->calloc(1, 1024);
+    cmark_arena_clear(arena);
+  }
+  cmark_arena_get_stats(arena, &stats);
+  OK(runner, stats.capacity < spike, "spike capacity is trimmed");
+  OK(runner, stats.chunks >= 1, "trimmed arena keeps a chunk");
+
+  // An oversized allocation takes a retained chunk that fits.  The
+  // small chunk that cmark_arena_push() starts makes 1 MB oversized.
+  cmark_arena *retained = cmark_arena_new();
+  cmark_arena_set_current(retained);
+  mem->calloc(1, 16);
+  mem->calloc(1, 5 * 1048576);
+  cmark_arena_clear(retained);
+  mem->calloc(1, 16);
+  cmark_arena_push();
+  cmark_arena_get_stats(retained, &stats);
+  size_t chunks = stats.chunks;
+  char *oversized = (char *)mem->calloc(1, 1048576);
+  OK(runner, oversized[0] == 0 && oversized[1048575] == 0,
+     "oversized allocation is zeroed");
+  cmark_arena_get_stats(retained, &stats);
+  INT_EQ(runner, (int)stats.chunks, (int)chunks,
+         "oversized allocation reuses a retained chunk");
+  cmark_arena_set_current(arena);
+  cmark_arena_free(retained);
+
+  // Growing a block after switching to an empty arena copies it there.
+  char *block = (char *)mem->realloc(NULL, 16);
+  memcpy(block, "switched", 9);
+  cmark_arena *empty = cmark_arena_new();
+  cmark_arena_set_current(empty);
+  char *copied = (char *)mem->realloc(block, 64);
+  STR_EQ(runner, copied, "switched",
+         "realloc into an empty arena keeps contents");
+  cmark_arena_get_stats(empty, &stats);
+  INT_EQ(runner, (int)stats.chunks, 1,
+         "realloc into an empty arena allocates there");
+  cmark_arena_set_current(arena);
+  cmark_arena_free(empty);
+
+  OK(runner, cmark_arena_set_current(prev) == arena,
+     "set_current returns previous arena");
+  cmark_arena_free(arena);
+}
+
 static void ref_source_pos(test_batch_runner *runner) {
   static const char markdown[] =
     "Let's try [reference] links.\n"
@@ -1129,6 +1257,901 @@ static void ref_source_pos(test_batch_runner *runner) {
   cmark_node_free(doc);
 }
 
+static char *parse_with_threads(const char *markdown, size_t len, int options,
+                                int threads) {
+  cmark_parser *parser = cmark_parser_new(options);
+  cmark_parser_attach_syntax_extension(
+      parser, cmark_find_syntax_extension("strikethrough"));
+  cmark_parser_attach_syntax_extension(parser,
+                                       cmark_find_syntax_extension("table"));
+  cmark_parser_set_threads(parser, threads);
+  cmark_parser_feed(parser, markdown, len);
+  cmark_node *doc = cmark_parser_finish(parser);
+  char *html = cmark_render_html(doc, options, NULL);
+  cmark_node_free(doc);
+  cmark_parser_free(parser);
+  return html;
+}
+
+static void parallel_inlines(test_batch_runner *runner) {
+  static const char block[] =
+      "Some *emphasis*, ~~struck~~ text, `code` and a [link][ref %d].[^%d]\n"
+      "\n"
+      "| a | b |\n"
+      "|---|---|\n"
+      "| **%d** | [ref %d] |\n"
+      "\n"
+      "[^%d]: Footnote %d.\n"
+      "\n";
+  const size_t size = 4000 * sizeof(block) * 2;
+  char *markdown = (char *)malloc(size);
+  size_t len = 0;
+  int options = CMARK_OPT_DEFAULT | CMARK_OPT_FOOTNOTES;
+
+  cmark_gfm_core_extensions_ensure_registered();
+  for (int i = 0; i < 4000; ++i)
+    len += snprintf(markdown + len, size - len, block, i % 500, i, i, i % 700,
+                    i, i);
+  for (int i = 0; i < 500; ++i)
+    len += snprintf(markdown + len, size - len, "[ref %d]: /url/%d\n", i, i);
+
+  char *serial = parse_with_threads(markdown, len, options, 1);
+  char *parallel = parse_with_threads(markdown, len, options, 4);
+  OK(runner, strstr(serial, "<a href=\"/url/499\">") != NULL,
+     "document is parsed");
+  OK(runner, strcmp(serial, parallel) == 0,
+     "parallel inline parsing matches serial parsing");
+
+  free(serial);
+  free(parallel);
+  free(markdown);
+}
+
+static void parallel_blocks(test_batch_runner *runner) {
+  static const char block[] =
+      "Paragraph %d with a [link][ref %d].\n"
+      "\n"
+      "- item\n"
+      "\n"
+      "  continued\n"
+      "\n"
+      "```\n"
+      "code\n"
+      "\n"
+      "still code %d\n"
+      "```\n"
+      "\n"
+      "<!--\n"
+      "\n"
+      "comment\n"
+      "-->\n"
+      "\n";
+  const size_t size = 12000 * sizeof(block) * 2;
+  char *markdown = (char *)malloc(size);
+  size_t len = 0;
+  int options = CMARK_OPT_DEFAULT | CMARK_OPT_SOURCEPOS;
+
+  for (int i = 0; i < 12000; ++i)
+    len += snprintf(markdown + len, size - len, block, i, i % 100, i);
+  for (int i = 0; i < 100; ++i)
+    len += snprintf(markdown + len, size - len, "[ref %d]: /url/%d\n", i, i);
+
+  cmark_node *doc = cmark_parse_document(markdown, len, options);
+  char *serial = cmark_render_xml(doc, options);
+  cmark_node_free(doc);
+
+  cmark_parser *parser = cmark_parser_new(options);
+  cmark_parser_set_threads(parser, 4);
+  doc = cmark_parser_parse_document(parser, markdown, len);
+  char *parallel = cmark_render_xml(doc, options);
+  cmark_node_free(doc);
+  cmark_parser_free(parser);
+
+  OK(runner, strstr(serial, "destination=\"/url/99\"") != NULL,
+     "document is parsed");
+  OK(runner, strcmp(serial, parallel) == 0,
+     "parallel block parsing matches serial parsing");
+
+  free(serial);
+  free(parallel);
+  free(markdown);
+}
+
+static cmark_node *reparse_edit(cmark_node *doc, const char *old_text,
+                                const char *text, size_t offset,
+                                size_t removed, int options) {
+  cmark_parser *parser = cmark_parser_new(options);
+  doc = cmark_parser_reparse(parser, doc, old_text, strlen(old_text), text,
+                             strlen(text), offset, removed);
+  cmark_parser_free(parser);
+  return doc;
+}
+
+static void incremental_reparse(test_batch_runner *runner) {
+  static const char old_text[] =
+      "First paragraph.\n"
+      "\n"
+      "- item one\n"
+      "- item two\n"
+      "\n"
+      "Middle paragraph.\n"
+      "\n"
+      "```\n"
+      "code\n"
+      "```\n"
+      "\n"
+      "Last [paragraph].\n";
+  static const struct {
+    const char *text;
+    size_t offset;
+    size_t removed;
+    const char *desc;
+  } edits[] = {
+      {"First paragraph.\n"
+       "\n"
+       "- item one\n"
+       "- item 2\n"
+       "\n"
+       "Middle paragraph.\n"
+       "\n"
+       "```\n"
+       "code\n"
+       "```\n"
+       "\n"
+       "Last [paragraph].\n",
+       36, 3, "edit inside a list"},
+      {"First paragraph.\n"
+       "\n"
+       "- item one\n"
+       "- item two\n"
+       "\n"
+       "Middle\n"
+       "\n"
+       "more paragraph.\n"
+       "\n"
+       "```\n"
+       "code\n"
+       "```\n"
+       "\n"
+       "Last [paragraph].\n",
+       47, 1, "edit adding lines"},
+      {"First paragraph.\n"
+       "\n"
+       "- item one\n"
+       "- item two\n"
+       "\n"
+       "```\n"
+       "Middle paragraph.\n"
+       "\n"
+       "```\n"
+       "code\n"
+       "```\n"
+       "\n"
+       "Last [paragraph].\n",
+       41, 0, "edit opening a fence"},
+      {"First paragraph.\n"
+       "\n"
+       "- item one\n"
+       "- item two\n"
+       "\n"
+       "Middle paragraph.\n"
+       "\n"
+       "```\n"
+       "code\n"
+       "```\n"
+       "\n"
+       "Last [paragraph].\n"
+       "\n"
+       "[paragraph]: /url\n",
+       92, 0, "edit adding a reference"},
+  };
+  int options = CMARK_OPT_DEFAULT | CMARK_OPT_SOURCEPOS;
+
+  for (size_t i = 0; i < sizeof(edits) / sizeof(edits[0]); ++i) {
+    cmark_node *doc =
+        cmark_parse_document(old_text, sizeof(old_text) - 1, options);
+    cmark_node *last = cmark_node_last_child(doc);
+
+    doc = reparse_edit(doc, old_text, edits[i].text, edits[i].offset,
+                       edits[i].removed, options);
+
+    cmark_node *full =
+        cmark_parse_document(edits[i].text, strlen(edits[i].text), options);
+    char *expected = cmark_render_xml(full, options);
+    char *xml = cmark_render_xml(doc, options);
+    STR_EQ(runner, xml, expected, "reparse after %s", edits[i].desc);
+    if (i < 2)
+      OK(runner, cmark_node_last_child(doc) == last,
+         "untouched block is kept after %s", edits[i].desc);
+
+    free(expected);
+    free(xml);
+    cmark_node_free(full);
+    cmark_node_free(doc);
+  }
+}
+
+static void reparse_with_definitions(test_batch_runner *runner) {
+  static const char old_text[] =
+      "First paragraph.\n"
+      "\n"
+      "```\n"
+      "[code]: /code\n"
+      "```\n"
+      "\n"
+      "[url]: /url\n"
+      "\n"
+      "Last [url].\n";
+  static const struct {
+    const char *text;
+    size_t offset;
+    size_t removed;
+    bool kept;
+    const char *desc;
+  } edits[] = {
+      {"First [url].\n"
+       "\n"
+       "```\n"
+       "[code]: /code\n"
+       "```\n"
+       "\n"
+       "[url]: /url\n"
+       "\n"
+       "Last [url].\n",
+       6, 9, true, "edit using a reference"},
+      {"First paragraph.\n"
+       "\n"
+       "```\n"
+       "[code]: /other\n"
+       "```\n"
+       "\n"
+       "[url]: /url\n"
+       "\n"
+       "Last [url].\n",
+       31, 4, true, "edit inside a fence"},
+      {"First paragraph.\n"
+       "\n"
+       "```\n"
+       "[code]: /code\n"
+       "```\n"
+       "\n"
+       "[url]: /changed\n"
+       "\n"
+       "Last [url].\n",
+       49, 3, false, "edit changing a reference"},
+  };
+  int options = CMARK_OPT_DEFAULT | CMARK_OPT_SOURCEPOS;
+
+  for (size_t i = 0; i < sizeof(edits) / sizeof(edits[0]); ++i) {
+    cmark_node *doc =
+        cmark_parse_document(old_text, sizeof(old_text) - 1, options);
+    cmark_node *old_doc = doc;
+    cmark_node *last = cmark_node_last_child(doc);
+
+    doc = reparse_edit(doc, old_text, edits[i].text, edits[i].offset,
+                       edits[i].removed, options);
+
+    cmark_node *full =
+        cmark_parse_document(edits[i].text, strlen(edits[i].text), options);
+    char *expected = cmark_render_xml(full, options);
+    char *xml = cmark_render_xml(doc, options);
+    STR_EQ(runner, xml, expected, "reparse after %s", edits[i].desc);
+    if (edits[i].kept)
+      OK(runner, doc == old_doc && cmark_node_last_child(doc) == last,
+         "untouched block is kept after %s", edits[i].desc);
+
+    free(expected);
+    free(xml);
+    cmark_node_free(full);
+    cmark_node_free(doc);
+  }
+}
+
+typedef struct {
+  char html[1024];
+  int blocks;
+} streamed_blocks;
+
+static void collect_block(cmark_node *document, void *data) {
+  streamed_blocks *streamed = (streamed_blocks *)data;
+  char *html = cmark_render_html(document, CMARK_OPT_DEFAULT, NULL);
+  size_t len = strlen(streamed->html);
+
+  snprintf(streamed->html + len, sizeof(streamed->html) - len, "%s", html);
+  streamed->blocks++;
+  free(html);
+  cmark_node_free(document);
+}
+
+static void block_callback(test_batch_runner *runner) {
+  static const char markdown[] = "Uses [ref] before it is defined.\n"
+                                 "\n"
+                                 "- a list\n"
+                                 "\n"
+                                 "[ref]: /url\n"
+                                 "\n"
+                                 "Uses [ref] again.\n";
+  char *expected = cmark_markdown_to_html(markdown, sizeof(markdown) - 1,
+                                          CMARK_OPT_DEFAULT);
+  streamed_blocks streamed = {"", 0};
+  cmark_parser *parser = cmark_parser_new(CMARK_OPT_DEFAULT);
+  cmark_node *doc;
+
+  cmark_parser_set_block_callback(parser, collect_block, &streamed,
+                                  CMARK_STREAM_DEFINED_SO_FAR);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  INT_EQ(runner, streamed.blocks, 2, "complete blocks are streamed");
+  doc = cmark_parser_finish(parser);
+  OK(runner, cmark_node_first_child(doc) == NULL,
+     "finish returns an empty document");
+  cmark_node_free(doc);
+  INT_EQ(runner, streamed.blocks, 3, "finish streams the last block");
+  STR_EQ(runner, streamed.html,
+         "<p>Uses [ref] before it is defined.</p>\n"
+         "<ul>\n"
+         "<li>a list</li>\n"
+         "</ul>\n"
+         "<p>Uses <a href=\"/url\">ref</a> again.</p>\n",
+         "links only use earlier definitions");
+
+  streamed.html[0] = '\0';
+  streamed.blocks = 0;
+  cmark_parser_set_block_callback(parser, collect_block, &streamed,
+                                  CMARK_STREAM_WAIT_FOR_DEFINITIONS);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  INT_EQ(runner, streamed.blocks, 0, "blocks wait for definitions");
+  cmark_node_free(cmark_parser_finish(parser));
+  STR_EQ(runner, streamed.html, expected,
+         "waiting for definitions matches a regular parse");
+
+  streamed.html[0] = '\0';
+  streamed.blocks = 0;
+  cmark_parser_set_block_callback(parser, NULL, NULL,
+                                  CMARK_STREAM_COLLECT_DEFINITIONS);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  cmark_node_free(cmark_parser_finish(parser));
+  cmark_parser_set_block_callback(parser, collect_block, &streamed,
+                                  CMARK_STREAM_DEFINED_SO_FAR);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  INT_EQ(runner, streamed.blocks, 2, "second pass streams blocks");
+  cmark_node_free(cmark_parser_finish(parser));
+  STR_EQ(runner, streamed.html, expected,
+         "two passes match a regular parse");
+
+  cmark_parser_free(parser);
+  free(expected);
+}
+
+// Replaces a paragraph with two thematic breaks.
+static cmark_node *split_paragraph(cmark_syntax_extension *ext,
+                                   cmark_parser *parser, cmark_node *block) {
+  (void)ext;
+  (void)parser;
+  if (cmark_node_get_type(block) == CMARK_NODE_PARAGRAPH) {
+    cmark_node_insert_before(block, cmark_node_new(CMARK_NODE_THEMATIC_BREAK));
+    cmark_node_insert_before(block, cmark_node_new(CMARK_NODE_THEMATIC_BREAK));
+    cmark_node_free(block);
+  }
+  return NULL;
+}
+
+static void streamed_postprocess(test_batch_runner *runner) {
+  static const char markdown[] = "Paragraph.\n"
+                                 "\n"
+                                 "- a list\n";
+  cmark_syntax_extension *ext = cmark_syntax_extension_new("split");
+  cmark_parser *parser = cmark_parser_new(CMARK_OPT_DEFAULT);
+  streamed_blocks streamed = {"", 0};
+
+  cmark_syntax_extension_set_postprocess_func(ext, split_paragraph);
+  cmark_parser_attach_syntax_extension(parser, ext);
+  cmark_parser_set_block_callback(parser, collect_block, &streamed,
+                                  CMARK_STREAM_DEFINED_SO_FAR);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  cmark_node_free(cmark_parser_finish(parser));
+  INT_EQ(runner, streamed.blocks, 3, "replacement blocks are streamed");
+  STR_EQ(runner, streamed.html,
+         "<hr />\n"
+         "<hr />\n"
+         "<ul>\n"
+         "<li>a list</li>\n"
+         "</ul>\n",
+         "blocks are streamed as postprocessed");
+
+  cmark_parser_free(parser);
+  cmark_syntax_extension_free(cmark_get_default_mem_allocator(), ext);
+}
+
+typedef struct {
+  char *html;
+  size_t len;
+  int writes;
+  int stop_after;
+} html_output;
+
+static int write_html(const char *data, size_t len, void *userdata) {
+  html_output *out = (html_output *)userdata;
+
+  out->html = (char *)realloc(out->html, out->len + len + 1);
+  memcpy(out->html + out->len, data, len);
+  out->len += len;
+  out->html[out->len] = '\0';
+  return ++out->writes == out->stop_after ? -1 : 0;
+}
+
+static void markdown_to_html_stream(test_batch_runner *runner) {
+  static const char block[] = "Paragraph %d uses [ref].\n"
+                              "\n"
+                              "> quote\n"
+                              "\n";
+  const size_t size = 1000 * sizeof(block) * 2;
+  char *markdown = (char *)malloc(size);
+  size_t len = 0;
+
+  for (int i = 0; i < 1000; ++i)
+    len += snprintf(markdown + len, size - len, block, i);
+  len += snprintf(markdown + len, size - len, "[ref]: /url\n");
+
+  for (int options = CMARK_OPT_DEFAULT; options <= CMARK_OPT_FOOTNOTES;
+       options += CMARK_OPT_FOOTNOTES) {
+    char *expected = cmark_markdown_to_html(markdown, len, options);
+    html_output out = {NULL, 0, 0, 0};
+
+    INT_EQ(runner,
+           cmark_markdown_to_html_stream(markdown, len, options, write_html,
+                                         &out),
+           0, "streaming HTML succeeds");
+    STR_EQ(runner, out.html, expected,
+           "streamed HTML matches cmark_markdown_to_html");
+    if (options == CMARK_OPT_DEFAULT)
+      OK(runner, out.writes > 1, "HTML is written in pieces");
+
+    free(out.html);
+    free(expected);
+  }
+
+  html_output out = {NULL, 0, 0, 2};
+  INT_EQ(runner,
+         cmark_markdown_to_html_stream(markdown, len, CMARK_OPT_DEFAULT,
+                                       write_html, &out),
+         -1, "a failed write is returned");
+  INT_EQ(runner, out.writes, 2, "a failed write stops the output");
+  free(out.html);
+
+  free(markdown);
+}
+
+static void render_to_sink(test_batch_runner *runner) {
+  static const char block[] = "Item %d of a *list* whose lines are long enough "
+                              "to wrap\n"
+                              "  more than once, with `code` and <b>html</b>.\n"
+                              "\n"
+                              "> 1. quoted\n"
+                              ">\n"
+                              ">     indented code\n"
+                              "\n";
+  const size_t size = 200 * sizeof(block) * 2;
+  char *markdown = (char *)malloc(size);
+  size_t len = 0;
+
+  for (int i = 0; i < 200; ++i)
+    len += snprintf(markdown + len, size - len, block, i);
+
+  cmark_node *doc = cmark_parse_document(markdown, len, CMARK_OPT_DEFAULT);
+
+  for (int format = 0; format < 6; ++format) {
+    for (int width = 0; width <= 20; width += 20) {
+      html_output out = {NULL, 0, 0, 0};
+      cmark_sink sink = {write_html, &out, 16};
+      char *expected;
+      int status;
+
+      switch (format) {
+      case 0:
+        expected = cmark_render_html(doc, CMARK_OPT_DEFAULT, NULL);
+        status = cmark_render_html_to_sink(doc, CMARK_OPT_DEFAULT, NULL, &sink);
+        break;
+      case 1:
+        expected = cmark_render_xml(doc, CMARK_OPT_DEFAULT);
+        status = cmark_render_xml_to_sink(doc, CMARK_OPT_DEFAULT, &sink);
+        break;
+      case 2:
+        expected = cmark_render_man(doc, CMARK_OPT_DEFAULT, width);
+        status = cmark_render_man_to_sink(doc, CMARK_OPT_DEFAULT, width, &sink);
+        break;
+      case 3:
+        expected = cmark_render_commonmark(doc, CMARK_OPT_DEFAULT, width);
+        status = cmark_render_commonmark_to_sink(doc, CMARK_OPT_DEFAULT, width,
+                                                 &sink);
+        break;
+      case 4:
+        expected = cmark_render_plaintext(doc, CMARK_OPT_DEFAULT, width);
+        status = cmark_render_plaintext_to_sink(doc, CMARK_OPT_DEFAULT, width,
+                                                &sink);
+        break;
+      default:
+        expected = cmark_render_latex(doc, CMARK_OPT_DEFAULT, width);
+        status = cmark_render_latex_to_sink(doc, CMARK_OPT_DEFAULT, width,
+                                            &sink);
+        break;
+      }
+
+      INT_EQ(runner, status, 0, "rendering to a sink succeeds");
+      STR_EQ(runner, out.html, expected,
+             "output to a sink matches the returned string");
+      OK(runner, out.writes > 100, "output is written in pieces");
+
+      free(out.html);
+      free(expected);
+    }
+  }
+
+  html_output out = {NULL, 0, 0, 3};
+  cmark_sink sink = {write_html, &out, 0};
+  INT_EQ(runner, cmark_render_commonmark_to_sink(doc, CMARK_OPT_DEFAULT, 0,
+                                                 &sink),
+         -1, "a failed write is returned");
+  INT_EQ(runner, out.writes, 3, "a failed write stops the output");
+  free(out.html);
+
+  cmark_node_free(doc);
+  free(markdown);
+}
+
+static void render_html_to_buffer(test_batch_runner *runner) {
+  static const char markdown[] = "# Title\n"
+                                 "\n"
+                                 "Some *text* with a [link](/url \"title\") "
+                                 "& `code`.\n"
+                                 "\n"
+                                 "```c\n"
+                                 "int x < 1;\n"
+                                 "```\n";
+  cmark_node *doc = cmark_parse_document(markdown, sizeof(markdown) - 1,
+                                         CMARK_OPT_DEFAULT);
+  char *expected = cmark_render_html(doc, CMARK_OPT_DEFAULT, NULL);
+  size_t len = strlen(expected);
+  size_t estimate = cmark_render_html_estimate(doc, CMARK_OPT_DEFAULT);
+  char buffer[256];
+
+  OK(runner, estimate >= len && estimate < 2 * len,
+     "the size estimate is close to the output");
+
+  INT_EQ(runner,
+         (int)cmark_render_html_to_buffer(doc, CMARK_OPT_DEFAULT, NULL, buffer,
+                                          sizeof(buffer)),
+         (int)len, "the output length is returned");
+  STR_EQ(runner, buffer, expected, "the output fits in the buffer");
+
+  INT_EQ(runner,
+         (int)cmark_render_html_to_buffer(doc, CMARK_OPT_DEFAULT, NULL, buffer,
+                                          10),
+         (int)len, "the needed length is returned for a small buffer");
+  INT_EQ(runner, memcmp(buffer, expected, 9) == 0 && buffer[9] == '\0', 1,
+         "output that does not fit is cut off");
+
+  INT_EQ(runner,
+         (int)cmark_render_html_to_buffer(doc, CMARK_OPT_DEFAULT, NULL, NULL, 0),
+         (int)len, "the needed length is returned without a buffer");
+
+  free(expected);
+  cmark_node_free(doc);
+}
+
+static void serialize_tree(test_batch_runner *runner) {
+  static const char markdown[] = "# Title\n"
+                                 "\n"
+                                 "- [ ] Some *emphasis*, ~~struck~~ text\n"
+                                 "- `code` and a [link](/url \"title\")[^1]\n"
+                                 "\n"
+                                 "| a | b |\n"
+                                 "|:--|--:|\n"
+                                 "| **1** | <b>2</b> |\n"
+                                 "\n"
+                                 "```c\n"
+                                 "int x;\n"
+                                 "```\n"
+                                 "\n"
+                                 "[^1]: Footnote.\n";
+  int options = CMARK_OPT_SOURCEPOS | CMARK_OPT_FOOTNOTES;
+  static const char *extensions[] = {"strikethrough", "table", "tasklist"};
+  html_output out = {NULL, 0, 0, 0};
+
+  cmark_gfm_core_extensions_ensure_registered();
+  cmark_parser *parser = cmark_parser_new(options);
+  for (size_t i = 0; i < sizeof(extensions) / sizeof(*extensions); ++i)
+    cmark_parser_attach_syntax_extension(
+        parser, cmark_find_syntax_extension(extensions[i]));
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  cmark_node *doc = cmark_parser_finish(parser);
+  cmark_llist *syntax_extensions = cmark_parser_get_syntax_extensions(parser);
+
+  INT_EQ(runner, cmark_node_serialize(doc, write_html, &out), 0,
+         "serializing a tree succeeds");
+
+  cmark_node *loaded = cmark_node_deserialize(out.html, out.len);
+  OK(runner, loaded != NULL, "a serialized tree can be loaded");
+
+  char *expected = cmark_render_html(doc, options, syntax_extensions);
+  char *html = cmark_render_html(loaded, options, syntax_extensions);
+  STR_EQ(runner, html, expected, "a loaded tree renders to the same HTML");
+  free(html);
+  free(expected);
+
+  expected = cmark_render_xml(doc, options);
+  html = cmark_render_xml(loaded, options);
+  STR_EQ(runner, html, expected, "a loaded tree renders to the same XML");
+  free(html);
+  free(expected);
+
+  expected = cmark_render_commonmark(doc, options, 0);
+  html = cmark_render_commonmark(loaded, options, 0);
+  STR_EQ(runner, html, expected,
+         "a loaded tree renders to the same CommonMark");
+  free(html);
+  free(expected);
+
+  OK(runner, cmark_node_deserialize(out.html, out.len - 1) == NULL,
+     "truncated data is rejected");
+  out.html[0] = 'X';
+  OK(runner, cmark_node_deserialize(out.html, out.len) == NULL,
+     "data without the header is rejected");
+
+  cmark_node_free(loaded);
+  cmark_node_free(doc);
+  cmark_parser_free(parser);
+  free(out.html);
+}
+
+static void parsed_inline_nodes(test_batch_runner *runner) {
+  cmark_node *doc = cmark_parse_document("*a* b\n", 6, CMARK_OPT_DEFAULT);
+  cmark_node *emph = cmark_node_first_child(cmark_node_first_child(doc));
+  cmark_node *text = cmark_node_next(emph);
+
+  STR_EQ(runner, cmark_node_get_literal(text), " b",
+         "parsed text node has its literal");
+  OK(runner, cmark_node_set_string_content(text, "content"),
+     "parsed text node takes string content");
+  STR_EQ(runner, cmark_node_get_string_content(text), "content",
+         "parsed text node has its string content");
+  OK(runner, cmark_node_set_type(text, CMARK_NODE_LINK),
+     "parsed text node can become a link");
+  OK(runner, cmark_node_set_url(text, "/other"), "converted link takes a url");
+  OK(runner, cmark_node_set_type(text, CMARK_NODE_CODE),
+     "parsed text node can become inline code");
+  OK(runner, cmark_node_set_type(emph, CMARK_NODE_IMAGE),
+     "parsed emphasis can become an image");
+  OK(runner, cmark_node_set_type(emph, CMARK_NODE_EMPH),
+     "and back into emphasis");
+  OK(runner, cmark_node_set_literal(text, "b"),
+     "parsed inline node takes a new literal");
+
+  cmark_node *link = cmark_node_new(CMARK_NODE_LINK);
+  cmark_node_set_url(link, "/url");
+  OK(runner, cmark_node_append_child(link, text),
+     "parsed inline node can be moved under a new node");
+  cmark_node_append_child(cmark_node_first_child(doc), link);
+
+  char *html = cmark_render_html(doc, CMARK_OPT_DEFAULT, NULL);
+  STR_EQ(runner, html, "<p><em>a</em><a href=\"/url\"><code>b</code></a></p>\n",
+         "tree with parsed inline nodes renders");
+  free(html);
+
+  cmark_node_free(doc);
+}
+
+static void node_pool(test_batch_runner *runner) {
+  static const char markdown[] = "para *one*\n\npara **two**\n\npara three\n";
+  cmark_parser *parser = cmark_parser_new(CMARK_OPT_DEFAULT);
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  cmark_node *doc = cmark_parser_finish(parser);
+  cmark_node *second = cmark_node_next(cmark_node_first_child(doc));
+  cmark_node *other = cmark_node_new(CMARK_NODE_DOCUMENT);
+
+  cmark_node_free(cmark_node_last_child(doc));
+  OK(runner, cmark_node_append_child(other, second),
+     "parsed node can be moved to a new document");
+  cmark_parser_free(parser);
+  cmark_node_free(doc);
+
+  char *html = cmark_render_html(other, CMARK_OPT_DEFAULT, NULL);
+  STR_EQ(runner, html, "<p>para <strong>two</strong></p>\n",
+         "parsed nodes outlive their parser and document");
+  free(html);
+
+  cmark_node *text = cmark_node_new(CMARK_NODE_TEXT);
+  cmark_node_set_literal(text, "new ");
+  OK(runner, cmark_node_prepend_child(second, text),
+     "new node can be added to a parsed tree");
+  html = cmark_render_html(other, CMARK_OPT_DEFAULT, NULL);
+  STR_EQ(runner, html, "<p>new para <strong>two</strong></p>\n",
+         "mixed tree renders");
+  free(html);
+
+  cmark_node_free(other);
+}
+
+static void html_escaping(test_batch_runner *runner) {
+  // Long enough for the vectorized scan, with escapes at every offset
+  // of a 32-byte block and in the tail.
+  static const char specials[] = "<>&\"'/";
+  char code[100], expected[700];
+  size_t i, j, len;
+
+  for (i = 0; i < 70; i += 3) {
+    char *out = expected;
+
+    for (j = 0; j < 70; ++j)
+      code[j] = j % 7 == i % 7 || j == i ? specials[j % 6]
+                                         : (char)('a' + j % 26);
+    code[70] = '\0';
+
+    out += sprintf(out, "<pre><code>");
+    for (j = 0; j < 70; ++j) {
+      switch (code[j]) {
+      case '<': out += sprintf(out, "&lt;"); break;
+      case '>': out += sprintf(out, "&gt;"); break;
+      case '&': out += sprintf(out, "&amp;"); break;
+      case '"': out += sprintf(out, "&quot;"); break;
+      default: *out++ = code[j];
+      }
+    }
+    sprintf(out, "\n</code></pre>\n");
+
+    len = strlen(code);
+    memmove(code + 4, code, len + 1);
+    memcpy(code, "    ", 4);
+    char *html = cmark_markdown_to_html(code, len + 4, CMARK_OPT_DEFAULT);
+    STR_EQ(runner, html, expected, "escapes at offset %d", (int)i);
+    free(html);
+  }
+}
+
+static void utf8_validation(test_batch_runner *runner) {
+  // Long lines of two-byte characters, so that the vectorized check runs,
+  // with a bad sequence moved across block boundaries and into the tail.
+  static const char *bad[] = {"\xC3", "\x80", "\xE0\x80\xAF", "\xED\xA0\x80",
+                              "\xF4\x90\x80\x80", "\xF0\x9F\x98", "\0"};
+  static const size_t bad_len[] = {1, 1, 3, 3, 4, 3, 1};
+  char md[200], expected[200];
+  size_t i, k;
+
+  for (k = 0; k < sizeof(bad_len) / sizeof(*bad_len); ++k) {
+    for (i = 0; i < 80; i += 7) {
+      size_t m = 0, e = 0, j;
+
+      for (j = 0; j < 80; j += 2) {
+        if (j == i) {
+          memcpy(md + m, bad[k], bad_len[k]);
+          m += bad_len[k];
+          memcpy(expected + e, UTF8_REPL, 3);
+          e += 3;
+        }
+        memcpy(md + m, "\xC3\xA9", 2);
+        m += 2;
+        memcpy(expected + e, "\xC3\xA9", 2);
+        e += 2;
+      }
+      expected[e] = '\0';
+
+      char *html = cmark_markdown_to_html(md, m, CMARK_OPT_VALIDATE_UTF8);
+      char *p = html + 3;
+      size_t plen = strlen(html) - 8;
+      OK(runner,
+         strncmp(html, "<p>", 3) == 0 && plen == e &&
+             memcmp(p, expected, e) == 0,
+         "invalid sequence %d at offset %d", (int)k, (int)i);
+      free(html);
+    }
+  }
+}
+
+static void case_folding(test_batch_runner *runner) {
+  // Non-ASCII labels take the full case fold, with long ASCII runs
+  // lowercased a word at a time.
+  static const char markdown[] =
+      "[\xC3\x81" "BCDEFGHIJKLMNOPQRSTUVWXYZ stra\xC3\x9F" "e \xC7\x84]\n"
+      "\n"
+      "[\xC3\xA1" "bcdefghijklmnopqrstuvwxyz STRASSE \xC7\x86]: /url\n";
+  char *html = cmark_markdown_to_html(markdown, sizeof(markdown) - 1,
+                                      CMARK_OPT_DEFAULT);
+  STR_EQ(runner, html,
+         "<p><a href=\"/url\">\xC3\x81" "BCDEFGHIJKLMNOPQRSTUVWXYZ "
+         "stra\xC3\x9F" "e \xC7\x84</a></p>\n",
+         "case folded labels match");
+  free(html);
+}
+
+static void integer_formatting(test_batch_runner *runner) {
+  static const int values[] = {0,   7,   -7,    9,        10,      99,
+                               100, 999, -1000, 65536,    1000000, 2147483647,
+                               -2147483647 - 1};
+  cmark_strbuf buf;
+  char expected[32];
+  size_t i;
+
+  cmark_strbuf_init(cmark_get_default_mem_allocator(), &buf, 0);
+  for (i = 0; i < sizeof(values) / sizeof(*values); ++i) {
+    cmark_strbuf_clear(&buf);
+    cmark_strbuf_putc(&buf, '<');
+    cmark_strbuf_put_int(&buf, values[i]);
+    cmark_strbuf_putc(&buf, '>');
+    snprintf(expected, sizeof(expected), "<%d>", values[i]);
+    STR_EQ(runner, (const char *)buf.ptr, expected, "put_int %d", values[i]);
+  }
+  cmark_strbuf_free(&buf);
+
+  static const char markdown[] = "# Title\n"
+                                 "\n"
+                                 "12. item\n";
+  cmark_node *doc =
+      cmark_parse_document(markdown, sizeof(markdown) - 1, CMARK_OPT_DEFAULT);
+  char *xml = cmark_render_xml(doc, CMARK_OPT_SOURCEPOS);
+  OK(runner, strstr(xml, "<heading sourcepos=\"1:1-1:7\" level=\"1\">") != NULL,
+     "heading sourcepos and level");
+  OK(runner,
+     strstr(xml, "<list sourcepos=\"3:1-3:8\" type=\"ordered\" start=\"12\" "
+                 "delim=\"period\" tight=\"true\">") != NULL,
+     "list sourcepos and start");
+  free(xml);
+  char *html = cmark_render_html(doc, CMARK_OPT_SOURCEPOS, NULL);
+  STR_EQ(runner, html,
+         "<h1 data-sourcepos=\"1:1-1:7\">Title</h1>\n"
+         "<ol start=\"12\" data-sourcepos=\"3:1-3:8\">\n"
+         "<li data-sourcepos=\"3:1-3:8\">item</li>\n"
+         "</ol>\n",
+         "html sourcepos and start");
+  free(html);
+  cmark_node_free(doc);
+}
+
+static void commonmark_url_encoding(test_batch_runner *runner) {
+  static const char markdown[] = "[link](<a\tb c>)\n";
+  cmark_node *doc =
+      cmark_parse_document(markdown, sizeof(markdown) - 1, CMARK_OPT_DEFAULT);
+  cmark_node *link = cmark_node_first_child(cmark_node_first_child(doc));
+  char *commonmark = cmark_render_commonmark(doc, CMARK_OPT_DEFAULT, 0);
+  STR_EQ(runner, commonmark, "[link](a%09b%20c)\n",
+         "tab and space in url are percent-encoded");
+  free(commonmark);
+
+  cmark_node_set_url(link, "a\nb\rc");
+  commonmark = cmark_render_commonmark(doc, CMARK_OPT_DEFAULT, 0);
+  STR_EQ(runner, commonmark, "[link](a%0Ab%0Dc)\n",
+         "line endings in url are percent-encoded");
+  free(commonmark);
+  cmark_node_free(doc);
+}
+
+static void render_escaping(test_batch_runner *runner) {
+  // Pipes in table cells are escaped by the table extension, also in
+  // nodes after a sibling with an extension of its own, while text
+  // outside the table is left alone.
+  static const char markdown[] = "| a | b |\n"
+                                 "|---|---|\n"
+                                 "| x\\|y ~~s~~ t\\|u | `c\\|d` |\n"
+                                 "\n"
+                                 "> > v|w ~~x|y~~ z|z\n";
+  cmark_parser *parser = cmark_parser_new(CMARK_OPT_DEFAULT);
+  cmark_parser_attach_syntax_extension(
+      parser, cmark_find_syntax_extension("strikethrough"));
+  cmark_parser_attach_syntax_extension(parser,
+                                       cmark_find_syntax_extension("table"));
+  cmark_parser_feed(parser, markdown, sizeof(markdown) - 1);
+  cmark_node *doc = cmark_parser_finish(parser);
+  char *commonmark = cmark_render_commonmark(doc, CMARK_OPT_DEFAULT, 0);
+  STR_EQ(runner, commonmark,
+         "| a | b |\n"
+         "| --- | --- |\n"
+         "| x\\|y ~~s~~ t\\|u | `c\\|d` |\n"
+         "\n"
+         "> > v|w ~~x|y~~ z|z\n",
+         "escaping follows the enclosing extension");
+  free(commonmark);
+  cmark_node_free(doc);
+  cmark_parser_free(parser);
+}
+
 int main() {
   int retval;
   test_batch_runner *runner = test_batch_runner_new();
@@ -1159,6 +2182,25 @@ int main() {
   source_pos(runner);
   source_pos_inlines(runner);
   ref_source_pos(runner);
+  arena(runner);
+  parallel_inlines(runner);
+  parallel_blocks(runner);
+  incremental_reparse(runner);
+  reparse_with_definitions(runner);
+  block_callback(runner);
+  streamed_postprocess(runner);
+  markdown_to_html_stream(runner);
+  render_to_sink(runner);
+  render_html_to_buffer(runner);
+  serialize_tree(runner);
+  parsed_inline_nodes(runner);
+  node_pool(runner);
+  html_escaping(runner);
+  utf8_validation(runner);
+  case_folding(runner);
+  integer_formatting(runner);
+  commonmark_url_encoding(runner);
+  render_escaping(runner);
 
   test_print_summary(runner);
   retval = test_ok(runner) ? 0 : 1;
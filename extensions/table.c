@@ -745,7 +745,49 @@ static void opaque_free(cmark_syntax_extension *self, cmark_mem *mem, cmark_node
     free_node_table(mem, node->as.opaque);
   } else if (node->type == CMARK_NODE_TABLE_ROW) {
     free_node_table_row(mem, node->as.opaque);
+  } else if (node->type == CMARK_NODE_TABLE_CELL) {
+    mem->free(node->as.opaque);
+  }
+}
+
+static int opaque_serialize(cmark_syntax_extension *self, cmark_node *node,
+                            cmark_write_func write, void *userdata) {
+  if (node->type == CMARK_NODE_TABLE) {
+    node_table *t = (node_table *)node->as.opaque;
+    int status = write((const char *)&t->n_columns, sizeof(t->n_columns),
+                       userdata);
+    if (!status && t->alignments)
+      status = write((const char *)t->alignments, t->n_columns, userdata);
+    return status;
+  } else if (node->type == CMARK_NODE_TABLE_ROW) {
+    char is_header = ((node_table_row *)node->as.opaque)->is_header;
+    return write(&is_header, 1, userdata);
+  }
+  return 0;
+}
+
+static int opaque_deserialize(cmark_syntax_extension *self, cmark_mem *mem,
+                              cmark_node *node, const unsigned char *data,
+                              size_t len) {
+  if (node->type == CMARK_NODE_TABLE) {
+    node_table *t = (node_table *)node->as.opaque;
+    if (len < sizeof(t->n_columns))
+      return -1;
+    memcpy(&t->n_columns, data, sizeof(t->n_columns));
+    if (len == sizeof(t->n_columns))
+      return 0;
+    if (len != sizeof(t->n_columns) + t->n_columns)
+      return -1;
+    t->alignments = (uint8_t *)mem->calloc(t->n_columns, 1);
+    memcpy(t->alignments, data + sizeof(t->n_columns), t->n_columns);
+    return 0;
+  } else if (node->type == CMARK_NODE_TABLE_ROW) {
+    if (len != 1)
+      return -1;
+    ((node_table_row *)node->as.opaque)->is_header = data[0] != 0;
+    return 0;
   }
+  return len ? -1 : 0;
 }
 
 static int escape(cmark_syntax_extension *self, cmark_node *node, int c) {
@@ -772,6 +814,8 @@ cmark_syntax_extension *create_table_extension(void) {
   cmark_syntax_extension_set_html_render_func(self, html_render);
   cmark_syntax_extension_set_opaque_alloc_func(self, opaque_alloc);
   cmark_syntax_extension_set_opaque_free_func(self, opaque_free);
+  cmark_syntax_extension_set_opaque_serialize_func(self, opaque_serialize);
+  cmark_syntax_extension_set_opaque_deserialize_func(self, opaque_deserialize);
   cmark_syntax_extension_set_commonmark_escape_func(self, escape);
   CMARK_NODE_TABLE = cmark_syntax_extension_add_node(0);
   CMARK_NODE_TABLE_ROW = cmark_syntax_extension_add_node(0);
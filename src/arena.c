@@ -1,15 +1,39 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include "config.h"
 #include "cmark-gfm.h"
 #include "cmark-gfm-extension_api.h"
 
-static struct arena_chunk {
+struct arena_chunk {
   size_t sz, used;
   uint8_t push_point;
   void *ptr;
   struct arena_chunk *prev;
-} *A = NULL;
+};
+
+#define ARENA_CHUNK_SIZE (4 * 1048576)
+
+struct cmark_arena {
+  /* chunks handed out since the last clear, most recent first */
+  struct arena_chunk *head;
+  /* zeroed chunks kept by cmark_arena_clear, largest first */
+  struct arena_chunk *spare;
+  /* peak usage per document, decaying towards recent documents */
+  size_t high_water;
+  /* bytes left behind by reallocations that had to move */
+  size_t wasted;
+};
+
+// Every thread starts out with its own implicit arena, which backs the
+// legacy cmark_get_arena_mem_allocator() / cmark_arena_reset() interface.
+// cmark_arena_set_current() rebinds the calling thread to an explicit arena.
+static CMARK_THREAD_LOCAL cmark_arena thread_arena;
+static CMARK_THREAD_LOCAL cmark_arena *current_arena;
+
+static CMARK_INLINE cmark_arena *S_current(void) {
+  return current_arena ? current_arena : &thread_arena;
+}
 
 static struct arena_chunk *alloc_arena_chunk(size_t sz, struct arena_chunk *prev) {
   struct arena_chunk *c = (struct arena_chunk *)calloc(1, sizeof(*c));
@@ -23,44 +47,246 @@ static struct arena_chunk *alloc_arena_chunk(size_t sz, struct arena_chunk *prev
   return c;
 }
 
+static void free_arena_chunks(struct arena_chunk *c) {
+  while (c) {
+    struct arena_chunk *n = c->prev;
+    free(c->ptr);
+    free(c);
+    c = n;
+  }
+}
+
+static void release_arena(cmark_arena *arena) {
+  free_arena_chunks(arena->head);
+  free_arena_chunks(arena->spare);
+  arena->head = arena->spare = NULL;
+  arena->high_water = 0;
+  arena->wasted = 0;
+}
+
+// A thread's default arena is released when the thread exits, as long
+// as it has one of its own.
+#if defined(HAVE_PTHREAD) && defined(HAVE___THREAD)
+#include <pthread.h>
+
+static pthread_key_t thread_arena_key;
+static pthread_once_t thread_arena_once = PTHREAD_ONCE_INIT;
+
+static void release_thread_arena(void *arena) {
+  release_arena((cmark_arena *)arena);
+}
+
+static void create_thread_arena_key(void) {
+  pthread_key_create(&thread_arena_key, release_thread_arena);
+}
+
+static void register_thread_arena(void) {
+  pthread_once(&thread_arena_once, create_thread_arena_key);
+  pthread_setspecific(thread_arena_key, &thread_arena);
+}
+
+#elif defined(HAVE_WIN32_THREADS) && defined(_MSC_VER)
+#include <windows.h>
+
+static DWORD thread_arena_fls = FLS_OUT_OF_INDEXES;
+static INIT_ONCE thread_arena_once = INIT_ONCE_STATIC_INIT;
+
+static VOID NTAPI release_thread_arena(PVOID arena) {
+  if (arena)
+    release_arena((cmark_arena *)arena);
+}
+
+static BOOL CALLBACK create_thread_arena_fls(PINIT_ONCE once, PVOID param,
+                                             PVOID *ctx) {
+  (void)once;
+  (void)param;
+  (void)ctx;
+  thread_arena_fls = FlsAlloc(release_thread_arena);
+  return TRUE;
+}
+
+static void register_thread_arena(void) {
+  InitOnceExecuteOnce(&thread_arena_once, create_thread_arena_fls, NULL,
+                      NULL);
+  if (thread_arena_fls != FLS_OUT_OF_INDEXES)
+    FlsSetValue(thread_arena_fls, &thread_arena);
+}
+
+#else
+static void register_thread_arena(void) {}
+#endif
+
 void cmark_arena_push(void) {
-  if (!A)
+  cmark_arena *arena = S_current();
+  if (!arena->head)
     return;
-  A->push_point = 1;
-  A = alloc_arena_chunk(10240, A);
+  arena->head->push_point = 1;
+  arena->head = alloc_arena_chunk(10240, arena->head);
 }
 
 int cmark_arena_pop(void) {
-  if (!A)
+  cmark_arena *arena = S_current();
+  if (!arena->head)
     return 0;
-  while (A && !A->push_point) {
-    free(A->ptr);
-    struct arena_chunk *n = A->prev;
-    free(A);
-    A = n;
+  while (arena->head && !arena->head->push_point) {
+    struct arena_chunk *n = arena->head->prev;
+    free(arena->head->ptr);
+    free(arena->head);
+    arena->head = n;
   }
-  if (A)
-    A->push_point = 0;
+  if (arena->head)
+    arena->head->push_point = 0;
   return 1;
 }
 
-static void init_arena(void) {
-  A = alloc_arena_chunk(4 * 1048576, NULL);
+// Returns a chunk that can hold at least 'need' bytes, preferring one
+// retained by cmark_arena_clear over allocating a fresh 'sz'-byte chunk.
+static struct arena_chunk *next_arena_chunk(cmark_arena *arena, size_t need,
+                                            size_t sz,
+                                            struct arena_chunk *prev) {
+  struct arena_chunk *c = arena->spare;
+  if (c && c->sz >= need) {
+    arena->spare = c->prev;
+    c->prev = prev;
+    return c;
+  }
+  return alloc_arena_chunk(sz, prev);
+}
+
+// Takes the smallest chunk retained by cmark_arena_clear that can hold
+// 'need' bytes, if there is one.
+static struct arena_chunk *take_spare_chunk(cmark_arena *arena, size_t need) {
+  struct arena_chunk **p, **fit = NULL, *c;
+
+  for (p = &arena->spare; *p && (*p)->sz >= need; p = &(*p)->prev)
+    fit = p;
+  if (!fit)
+    return NULL;
+  c = *fit;
+  *fit = c->prev;
+  return c;
+}
+
+static void init_arena(cmark_arena *arena) {
+  if (arena == &thread_arena)
+    register_thread_arena();
+  arena->head = next_arena_chunk(arena, 0, ARENA_CHUNK_SIZE, NULL);
 }
 
 void cmark_arena_reset(void) {
-  while (A) {
-    free(A->ptr);
-    struct arena_chunk *n = A->prev;
-    free(A);
-    A = n;
+  release_arena(S_current());
+}
+
+cmark_arena *cmark_arena_new(void) {
+  cmark_arena *arena = (cmark_arena *)calloc(1, sizeof(*arena));
+  if (!arena)
+    abort();
+  return arena;
+}
+
+void cmark_arena_free(cmark_arena *arena) {
+  if (!arena)
+    return;
+  if (current_arena == arena)
+    current_arena = NULL;
+  release_arena(arena);
+  free(arena);
+}
+
+cmark_arena *cmark_arena_set_current(cmark_arena *arena) {
+  cmark_arena *prev = current_arena;
+  current_arena = arena;
+  return prev;
+}
+
+void cmark_arena_clear(cmark_arena *arena) {
+  struct arena_chunk *c, *n, **p, *sorted = NULL;
+  size_t peak = 0, limit, retained = 0;
+
+  if (!arena)
+    arena = S_current();
+
+  for (c = arena->head; c; c = c->prev)
+    peak += c->used;
+
+  // Track a high-water mark that follows spikes immediately but only
+  // decays gradually, so that one huge document does not pin its memory
+  // forever, while a steady stream of similar documents keeps what it needs.
+  if (peak >= arena->high_water)
+    arena->high_water = peak;
+  else
+    arena->high_water -= (arena->high_water - peak) / 4;
+
+  // Gather the used and spare chunks, largest first.  Only the bytes
+  // that were actually handed out need to be zeroed again.
+  for (c = arena->head; c; c = n) {
+    n = c->prev;
+    memset(c->ptr, 0, c->used);
+    c->used = 0;
+    c->push_point = 0;
+    for (p = &sorted; *p && (*p)->sz >= c->sz; p = &(*p)->prev)
+      ;
+    c->prev = *p;
+    *p = c;
+  }
+  for (c = arena->spare; c; c = n) {
+    n = c->prev;
+    for (p = &sorted; *p && (*p)->sz >= c->sz; p = &(*p)->prev)
+      ;
+    c->prev = *p;
+    *p = c;
+  }
+
+  // Retain enough capacity to cover the high-water mark, skipping chunks
+  // that are far larger than recent documents have needed.
+  limit = arena->high_water * 2;
+  if (limit < ARENA_CHUNK_SIZE)
+    limit = ARENA_CHUNK_SIZE;
+
+  arena->head = NULL;
+  arena->wasted = 0;
+  p = &arena->spare;
+  for (c = sorted; c; c = n) {
+    n = c->prev;
+    if ((retained == 0 || retained < arena->high_water) && c->sz <= limit) {
+      retained += c->sz;
+      *p = c;
+      p = &c->prev;
+    } else {
+      free(c->ptr);
+      free(c);
+    }
   }
+  *p = NULL;
+}
+
+void cmark_arena_get_stats(cmark_arena *arena, cmark_arena_stats *stats) {
+  struct arena_chunk *c;
+
+  if (!arena)
+    arena = S_current();
+
+  memset(stats, 0, sizeof(*stats));
+  for (c = arena->head; c; c = c->prev) {
+    stats->chunks++;
+    stats->capacity += c->sz;
+    stats->used += c->used;
+  }
+  for (c = arena->spare; c; c = c->prev) {
+    stats->chunks++;
+    stats->capacity += c->sz;
+  }
+  stats->high_water = arena->high_water;
+  stats->wasted = arena->wasted;
 }
 
 static void *arena_calloc(size_t nmem, size_t size) {
-  if (!A)
-    init_arena();
+  cmark_arena *arena = S_current();
+
+  if (!arena->head)
+    init_arena(arena);
 
+  struct arena_chunk *A = arena->head;
   size_t sz = nmem * size + sizeof(size_t);
 
   // Round allocation sizes to largest integer size to
@@ -69,11 +295,16 @@ static void *arena_calloc(size_t nmem, size_t size) {
   sz = (sz + align) & ~align;
 
   if (sz > A->sz) {
-    A->prev = alloc_arena_chunk(sz, A->prev);
-    return (uint8_t *) A->prev->ptr + sizeof(size_t);
-  }
-  if (sz > A->sz - A->used) {
-    A = alloc_arena_chunk(A->sz + A->sz / 2, A);
+    // Oversized allocations get a chunk of their own, tucked in behind
+    // the current one so that it stays available for bumping.
+    struct arena_chunk *c = take_spare_chunk(arena, sz);
+    if (c)
+      c->prev = A->prev;
+    else
+      c = alloc_arena_chunk(sz, A->prev);
+    A = A->prev = c;
+  } else if (sz > A->sz - A->used) {
+    A = arena->head = next_arena_chunk(arena, sz, A->sz + A->sz / 2, A);
   }
   void *ptr = (uint8_t *) A->ptr + A->used;
   A->used += sz;
@@ -82,12 +313,34 @@ static void *arena_calloc(size_t nmem, size_t size) {
 }
 
 static void *arena_realloc(void *ptr, size_t size) {
-  if (!A)
-    init_arena();
+  cmark_arena *arena = S_current();
+
+  if (!ptr)
+    return arena_calloc(1, size);
+
+  struct arena_chunk *A = arena->head;
+  size_t old_sz = ((size_t *) ptr)[-1];
+  const size_t align = sizeof(size_t) - 1;
+  size_t sz = (size + align) & ~align;
+
+  if (sz <= old_sz)
+    return ptr;
+
+  // The block being grown is usually the last one handed out (a
+  // cmark_strbuf being appended to); extend it in place if it fits.
+  // An arena without a chunk yet cannot hold the block: it came from
+  // another arena, and is copied into this one.
+  if (A && (uint8_t *) ptr + old_sz == (uint8_t *) A->ptr + A->used &&
+      sz - old_sz <= A->sz - A->used) {
+    A->used += sz - old_sz;
+    ((size_t *) ptr)[-1] = sz;
+    return ptr;
+  }
 
   void *new_ptr = arena_calloc(1, size);
-  if (ptr)
-    memcpy(new_ptr, ptr, ((size_t *) ptr)[-1]);
+  memcpy(new_ptr, ptr, old_sz);
+  if (A)
+    arena->wasted += old_sz + sizeof(size_t);
   return new_ptr;
 }
 
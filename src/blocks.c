@@ -22,6 +22,8 @@
 #include "houdini.h"
 #include "buffer.h"
 #include "footnotes.h"
+#include "simd.h"
+#include "parallel.h"
 
 #define CODE_INDENT 4
 #define TAB_STOP 4
@@ -66,17 +68,28 @@ static CMARK_INLINE bool S_is_space_or_tab(char c) {
 static void S_parser_feed(cmark_parser *parser, const unsigned char *buffer,
                           size_t len, bool eof);
 
+// A line parsed in place points into the caller's buffer, which may be
+// read-only, but the scanners temporarily NUL-terminate their input.
+// Copy such a line into curline before handing it to a scanner.
+static cmark_chunk *S_scannable_line(cmark_parser *parser,
+                                     cmark_chunk *input) {
+  if (parser->line.data != parser->curline.ptr) {
+    cmark_strbuf_set(&parser->curline, parser->line.data, parser->line.len);
+    parser->line.data = parser->curline.ptr;
+    input->data = parser->curline.ptr;
+  }
+  return input;
+}
+
 static void S_process_line(cmark_parser *parser, const unsigned char *buffer,
                            bufsize_t bytes);
 
-static cmark_node *make_block(cmark_mem *mem, cmark_node_type tag,
+static cmark_node *make_block(cmark_node_pool *pool, cmark_node_type tag,
                               int start_line, int start_column) {
-  cmark_node *e;
+  cmark_node *e = cmark_node_pool_alloc(pool);
 
-  e = (cmark_node *)mem->calloc(1, sizeof(*e));
-  cmark_strbuf_init(mem, &e->content, 32);
   e->type = (uint16_t)tag;
-  e->flags = CMARK_NODE__OPEN;
+  e->flags |= CMARK_NODE__OPEN;
   e->start_line = start_line;
   e->start_column = start_column;
   e->end_line = start_line;
@@ -85,8 +98,8 @@ static cmark_node *make_block(cmark_mem *mem, cmark_node_type tag,
 }
 
 // Create a root document node.
-static cmark_node *make_document(cmark_mem *mem) {
-  cmark_node *e = make_block(mem, CMARK_NODE_DOCUMENT, 1, 1);
+static cmark_node *make_document(cmark_node_pool *pool) {
+  cmark_node *e = make_block(pool, CMARK_NODE_DOCUMENT, 1, 1);
   return e;
 }
 
@@ -96,6 +109,7 @@ int cmark_parser_attach_syntax_extension(cmark_parser *parser,
   if (extension->match_inline || extension->insert_inline_from_delim) {
     parser->inline_syntax_extensions = cmark_llist_append(
       parser->mem, parser->inline_syntax_extensions, extension);
+    cmark_inlines_update_special_chars(parser, true);
   }
 
   return 1;
@@ -107,14 +121,29 @@ static void cmark_parser_dispose(cmark_parser *parser) {
 
   if (parser->refmap)
     cmark_map_free(parser->refmap);
+
+  if (parser->pool)
+    cmark_node_pool_release(parser->pool);
 }
 
 static void cmark_parser_reset(cmark_parser *parser) {
   cmark_llist *saved_exts = parser->syntax_extensions;
   cmark_llist *saved_inline_exts = parser->inline_syntax_extensions;
+  struct cmark_special_chars *saved_special_chars = parser->special_chars;
   int saved_options = parser->options;
+  int saved_threads = parser->threads;
+  cmark_block_callback saved_callback = parser->block_callback;
+  void *saved_callback_data = parser->block_callback_data;
+  cmark_stream_mode saved_stream_mode = parser->stream_mode;
+  cmark_map *saved_refmap = NULL;
   cmark_mem *saved_mem = parser->mem;
 
+  // The first of two streaming passes keeps its definitions.
+  if (parser->stream_mode == CMARK_STREAM_COLLECT_DEFINITIONS) {
+    saved_refmap = parser->refmap;
+    parser->refmap = NULL;
+  }
+
   cmark_parser_dispose(parser);
 
   memset(parser, 0, sizeof(cmark_parser));
@@ -123,25 +152,51 @@ static void cmark_parser_reset(cmark_parser *parser) {
   cmark_strbuf_init(parser->mem, &parser->curline, 256);
   cmark_strbuf_init(parser->mem, &parser->linebuf, 0);
 
-  cmark_node *document = make_document(parser->mem);
+  parser->pool = cmark_node_pool_new(parser->mem);
+  cmark_node *document = make_document(parser->pool);
 
-  parser->refmap = cmark_reference_map_new(parser->mem);
+  parser->refmap =
+      saved_refmap ? saved_refmap : cmark_reference_map_new(parser->mem);
   parser->root = document;
   parser->current = document;
 
   parser->syntax_extensions = saved_exts;
   parser->inline_syntax_extensions = saved_inline_exts;
+  parser->special_chars = saved_special_chars;
   parser->options = saved_options;
+  parser->threads = saved_threads;
+  parser->block_callback = saved_callback;
+  parser->block_callback_data = saved_callback_data;
+  parser->stream_mode = saved_stream_mode;
 }
 
 cmark_parser *cmark_parser_new_with_mem(int options, cmark_mem *mem) {
   cmark_parser *parser = (cmark_parser *)mem->calloc(1, sizeof(cmark_parser));
   parser->mem = mem;
   parser->options = options;
+  parser->threads = 1;
   cmark_parser_reset(parser);
+  cmark_inlines_update_special_chars(parser, true);
   return parser;
 }
 
+void cmark_parser_set_block_callback(cmark_parser *parser,
+                                     cmark_block_callback callback,
+                                     void *data, cmark_stream_mode mode) {
+  parser->block_callback = callback;
+  parser->block_callback_data = data;
+  parser->stream_mode = mode;
+}
+
+static bool S_streaming(cmark_parser *parser) {
+  return parser->block_callback != NULL ||
+         parser->stream_mode == CMARK_STREAM_COLLECT_DEFINITIONS;
+}
+
+void cmark_parser_set_threads(cmark_parser *parser, int threads) {
+  parser->threads = threads > 1 ? threads : 1;
+}
+
 cmark_parser *cmark_parser_new(int options) {
   extern cmark_mem CMARK_DEFAULT_MEM_ALLOCATOR;
   return cmark_parser_new_with_mem(options, &CMARK_DEFAULT_MEM_ALLOCATOR);
@@ -154,6 +209,7 @@ void cmark_parser_free(cmark_parser *parser) {
   cmark_strbuf_free(&parser->linebuf);
   cmark_llist_free(parser->mem, parser->syntax_extensions);
   cmark_llist_free(parser->mem, parser->inline_syntax_extensions);
+  mem->free(parser->special_chars);
   mem->free(parser);
 }
 
@@ -283,7 +339,7 @@ static cmark_node *finalize(cmark_parser *parser, cmark_node *b) {
          CMARK_NODE__OPEN); // shouldn't call finalize on closed blocks
   b->flags &= ~CMARK_NODE__OPEN;
 
-  if (parser->curline.size == 0) {
+  if (parser->line.len == 0) {
     // end of input - line number has not been incremented
     b->end_line = parser->line_number;
     b->end_column = parser->last_line_length;
@@ -291,10 +347,10 @@ static cmark_node *finalize(cmark_parser *parser, cmark_node *b) {
              (S_type(b) == CMARK_NODE_CODE_BLOCK && b->as.code.fenced) ||
              (S_type(b) == CMARK_NODE_HEADING && b->as.heading.setext)) {
     b->end_line = parser->line_number;
-    b->end_column = parser->curline.size;
-    if (b->end_column && parser->curline.ptr[b->end_column - 1] == '\n')
+    b->end_column = parser->line.len;
+    if (b->end_column && parser->line.data[b->end_column - 1] == '\n')
       b->end_column -= 1;
-    if (b->end_column && parser->curline.ptr[b->end_column - 1] == '\r')
+    if (b->end_column && parser->line.data[b->end_column - 1] == '\r')
       b->end_column -= 1;
   } else {
     b->end_line = parser->line_number - 1;
@@ -393,7 +449,7 @@ static cmark_node *add_child(cmark_parser *parser, cmark_node *parent,
   }
 
   cmark_node *child =
-      make_block(parser->mem, block_type, parser->line_number, start_column);
+      make_block(parser->pool, block_type, parser->line_number, start_column);
   child->parent = parent;
 
   if (parent->last_child) {
@@ -408,30 +464,105 @@ static cmark_node *add_child(cmark_parser *parser, cmark_node *parent,
 }
 
 void cmark_manage_extensions_special_characters(cmark_parser *parser, int add) {
-  cmark_llist *tmp_ext;
-
-  for (tmp_ext = parser->inline_syntax_extensions; tmp_ext; tmp_ext=tmp_ext->next) {
-    cmark_syntax_extension *ext = (cmark_syntax_extension *) tmp_ext->data;
-    cmark_llist *tmp_char;
-    for (tmp_char = ext->special_inline_chars; tmp_char; tmp_char=tmp_char->next) {
-      unsigned char c = (unsigned char)(size_t)tmp_char->data;
-      if (add)
-        cmark_inlines_add_special_character(c, ext->emphasis);
-      else
-        cmark_inlines_remove_special_character(c, ext->emphasis);
+  cmark_inlines_update_special_chars(parser, add != 0);
+}
+
+// Don't start threads for less inline content than this.
+#define PARALLEL_INLINES_MIN_BYTES (256 * 1024)
+
+typedef struct {
+  cmark_parser *parser;
+  cmark_node_pool *pool;
+  cmark_map *refmap;
+  int options;
+  cmark_node **blocks;
+  size_t count;
+} inline_batch;
+
+static void parse_inline_batch(void *arg) {
+  inline_batch *batch = (inline_batch *)arg;
+  size_t i;
+
+  for (i = 0; i < batch->count; ++i)
+    cmark_parse_inlines_with_pool(batch->parser, batch->pool, batch->blocks[i],
+                                  batch->refmap, batch->options);
+}
+
+// Inline parsing only reads the parser and the (complete) reference map,
+// and only touches the block it is parsing, so the blocks can be split
+// into runs of about the same size and parsed on separate threads, each
+// allocating nodes from a pool of its own.
+// Returns false, having done nothing, if the document is too small to
+// be worth it.
+static bool process_inlines_parallel(cmark_parser *parser,
+                                     cmark_map *refmap, int options) {
+  cmark_iter *iter = cmark_iter_new(parser->root);
+  cmark_node **blocks = NULL;
+  size_t count = 0, alloc = 0, total = 0, done = 0, per_batch, i;
+  inline_batch *batches;
+  int nbatches = 0;
+  cmark_event_type ev_type;
+  cmark_node *cur;
+
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    cur = cmark_iter_get_node(iter);
+    if (ev_type == CMARK_EVENT_ENTER && contains_inlines(cur)) {
+      if (count == alloc) {
+        alloc = alloc ? alloc * 2 : 64;
+        blocks = (cmark_node **)parser->mem->realloc(
+            blocks, alloc * sizeof(cmark_node *));
+      }
+      blocks[count++] = cur;
+      total += (size_t)cur->content.size;
+    }
+  }
+  cmark_iter_free(iter);
+
+  if (total < PARALLEL_INLINES_MIN_BYTES || count < 2) {
+    parser->mem->free(blocks);
+    return false;
+  }
+
+  batches = (inline_batch *)parser->mem->calloc((size_t)parser->threads,
+                                                sizeof(inline_batch));
+  per_batch = total / (size_t)parser->threads + 1;
+  for (i = 0; i < count; ++i) {
+    if (nbatches == 0 ||
+        (done >= per_batch * (size_t)nbatches && nbatches < parser->threads)) {
+      inline_batch *batch = &batches[nbatches++];
+      batch->parser = parser;
+      batch->pool = cmark_node_pool_new(parser->mem);
+      batch->refmap = refmap;
+      batch->options = options;
+      batch->blocks = &blocks[i];
     }
+    batches[nbatches - 1].count++;
+    done += (size_t)blocks[i]->content.size;
   }
+
+  cmark_parallel_run(parse_inline_batch, batches, sizeof(inline_batch),
+                     nbatches);
+
+  for (i = 0; i < (size_t)nbatches; ++i)
+    cmark_node_pool_release(batches[i].pool);
+  parser->mem->free(batches);
+  parser->mem->free(blocks);
+  return true;
 }
 
 // Walk through node and all children, recursively, parsing
 // string content into inline content where appropriate.
 static void process_inlines(cmark_parser *parser,
                             cmark_map *refmap, int options) {
-  cmark_iter *iter = cmark_iter_new(parser->root);
+  cmark_iter *iter;
   cmark_node *cur;
   cmark_event_type ev_type;
 
-  cmark_manage_extensions_special_characters(parser, true);
+  if (parser->threads > 1 && parser->mem != cmark_get_arena_mem_allocator() &&
+      process_inlines_parallel(parser, refmap, options))
+    return;
+
+  iter = cmark_iter_new(parser->root);
 
   while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
     cur = cmark_iter_get_node(iter);
@@ -442,8 +573,6 @@ static void process_inlines(cmark_parser *parser,
     }
   }
 
-  cmark_manage_extensions_special_characters(parser, false);
-
   cmark_iter_free(iter);
 }
 
@@ -485,17 +614,13 @@ static void process_footnotes(cmark_parser *parser) {
         if (!footnote->ix)
           footnote->ix = ++ix;
 
-        char n[32];
-        snprintf(n, sizeof(n), "%d", footnote->ix);
         cmark_chunk_free(parser->mem, &cur->as.literal);
         cmark_strbuf buf = CMARK_BUF_INIT(parser->mem);
-        cmark_strbuf_puts(&buf, n);
+        cmark_strbuf_put_int(&buf, (int)footnote->ix);
 
         cur->as.literal = cmark_chunk_buf_detach(&buf);
       } else {
-        cmark_node *text = (cmark_node *)parser->mem->calloc(1, sizeof(*text));
-        cmark_strbuf_init(parser->mem, &text->content, 0);
-        text->type = (uint16_t) CMARK_NODE_TEXT;
+        cmark_node *text = cmark_node_new_inline(parser->pool, CMARK_NODE_TEXT);
 
         cmark_strbuf buf = CMARK_BUF_INIT(parser->mem);
         cmark_strbuf_puts(&buf, "[^");
@@ -511,15 +636,21 @@ static void process_footnotes(cmark_parser *parser) {
 
   cmark_iter_free(iter);
 
-  if (map->sorted) {
-    qsort(map->sorted, map->size, sizeof(cmark_map_entry *), sort_footnote_by_ix);
-    for (unsigned int i = 0; i < map->size; ++i) {
-      cmark_footnote *footnote = (cmark_footnote *)map->sorted[i];
+  if (ix) {
+    cmark_map_entry **sorted = (cmark_map_entry **)parser->mem->calloc(
+        map->size, sizeof(cmark_map_entry *));
+    unsigned int i = 0;
+    for (cmark_map_entry *entry = map->refs; entry; entry = entry->next)
+      sorted[i++] = entry;
+    qsort(sorted, map->size, sizeof(cmark_map_entry *), sort_footnote_by_ix);
+    for (i = 0; i < map->size; ++i) {
+      cmark_footnote *footnote = (cmark_footnote *)sorted[i];
       if (!footnote->ix)
         continue;
       cmark_node_append_child(parser->root, footnote->node);
       footnote->node = NULL;
     }
+    parser->mem->free(sorted);
   }
 
   cmark_map_free(map);
@@ -622,14 +753,113 @@ static int lists_match(cmark_list *list_data, cmark_list *item_data) {
           list_data->bullet_char == item_data->bullet_char);
 }
 
-static cmark_node *finalize_document(cmark_parser *parser) {
+// Parses the inlines of a complete top-level block.  Returns whether a
+// link label in them matched no definition.
+static bool S_parse_block_inlines(cmark_parser *parser, cmark_node *block) {
+  cmark_iter *iter = cmark_iter_new(block);
+  cmark_event_type ev_type;
+  cmark_node *cur;
+  bool missed = false;
+
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    cur = cmark_iter_get_node(iter);
+    if (ev_type == CMARK_EVENT_ENTER && contains_inlines(cur)) {
+      cmark_parse_inlines(parser, cur, parser->refmap, parser->options);
+      if (cur->flags & CMARK_NODE__MISSED_LABEL)
+        missed = true;
+    }
+  }
+
+  cmark_iter_free(iter);
+  return missed;
+}
+
+// Undoes S_parse_block_inlines(), leaving the blocks' content alone.
+static void S_drop_block_inlines(cmark_node *block) {
+  cmark_node *node = block;
+
+  for (;;) {
+    if (contains_inlines(node)) {
+      while (node->first_child)
+        cmark_node_free(node->first_child);
+    } else if (node->first_child) {
+      node = node->first_child;
+      continue;
+    }
+    while (node != block && !node->next)
+      node = node->parent;
+    if (node == block)
+      break;
+    node = node->next;
+  }
+}
+
+// Moves a complete top-level block into a document of its own and
+// hands that to the block callback.
+static void S_emit_block(cmark_parser *parser, cmark_node *block) {
+  cmark_node *document = make_document(parser->pool);
+
+  document->flags &= ~CMARK_NODE__OPEN;
+  document->start_line = block->start_line;
+  document->start_column = block->start_column;
+  document->end_line = block->end_line;
+  document->end_column = block->end_column;
+
+  cmark_node_unlink(block);
+  cmark_node_append_child(document, block);
+  parser->block_callback(document, parser->block_callback_data);
+}
+
+// Passes the top-level blocks that were closed so far to the block
+// callback, unless they have to wait for definitions.
+static void S_stream_blocks(cmark_parser *parser) {
+  cmark_node *block, *next;
+  cmark_llist *tmp;
+
+  while ((block = parser->root->first_child) != NULL &&
+         !(block->flags & CMARK_NODE__OPEN)) {
+    if (parser->stream_mode == CMARK_STREAM_COLLECT_DEFINITIONS) {
+      cmark_node_free(block);
+      continue;
+    }
+    // Held blocks are parsed along with the rest of the document.
+    if (parser->holding_blocks)
+      return;
+    if (S_parse_block_inlines(parser, block) &&
+        parser->stream_mode == CMARK_STREAM_WAIT_FOR_DEFINITIONS) {
+      S_drop_block_inlines(block);
+      parser->holding_blocks = true;
+      return;
+    }
+
+    cmark_consolidate_text_nodes(block);
+    next = block->next;
+    for (tmp = parser->syntax_extensions; tmp; tmp = tmp->next) {
+      cmark_syntax_extension *ext = (cmark_syntax_extension *)tmp->data;
+      if (ext->postprocess_func && parser->root->first_child != next)
+        ext->postprocess_func(ext, parser, parser->root->first_child);
+    }
+    // Extensions change the block in place, and may have replaced it.
+    while ((block = parser->root->first_child) != next)
+      S_emit_block(parser, block);
+  }
+}
+
+// Close every open block, including the document.
+static void close_blocks(cmark_parser *parser) {
   while (parser->current != parser->root) {
     parser->current = finalize(parser, parser->current);
   }
 
   finalize(parser, parser->root);
+}
+
+static cmark_node *finalize_document(cmark_parser *parser) {
+  close_blocks(parser);
+  if (parser->stream_mode == CMARK_STREAM_COLLECT_DEFINITIONS)
+    S_stream_blocks(parser);
   process_inlines(parser, parser->refmap, parser->options);
-  if (parser->options & CMARK_OPT_FOOTNOTES)
+  if ((parser->options & CMARK_OPT_FOOTNOTES) && !S_streaming(parser))
     process_footnotes(parser);
 
   return parser->root;
@@ -696,14 +926,9 @@ static void S_parser_feed(cmark_parser *parser, const unsigned char *buffer,
     const unsigned char *eol;
     bufsize_t chunk_len;
     bool process = false;
-    for (eol = buffer; eol < end; ++eol) {
-      if (S_is_line_end_char(*eol)) {
-        process = true;
-        break;
-      }
-      if (*eol == '\0' && eol < end) {
-        break;
-      }
+    eol = cmark_simd_find3(buffer, end, '\n', '\r', '\0');
+    if (eol < end && *eol != '\0') {
+      process = true;
     }
     if (eol >= end && eof) {
       process = true;
@@ -715,6 +940,9 @@ static void S_parser_feed(cmark_parser *parser, const unsigned char *buffer,
         cmark_strbuf_put(&parser->linebuf, buffer, chunk_len);
         S_process_line(parser, parser->linebuf.ptr, parser->linebuf.size);
         cmark_strbuf_clear(&parser->linebuf);
+      } else if (eol < end && *eol == '\n') {
+        // pass the newline along, so that the line can be parsed in place
+        S_process_line(parser, buffer, chunk_len + 1);
       } else {
         S_process_line(parser, buffer, chunk_len);
       }
@@ -945,7 +1173,8 @@ static bool parse_code_block_prefix(cmark_parser *parser, cmark_chunk *input,
 
     if (parser->indent <= 3 && (peek_at(input, parser->first_nonspace) ==
                                 container->as.code.fence_char)) {
-      matched = scan_close_code_fence(input, parser->first_nonspace);
+      matched = scan_close_code_fence(S_scannable_line(parser, input),
+                                      parser->first_nonspace);
     }
 
     if (matched >= container->as.code.fence_length) {
@@ -1094,14 +1323,16 @@ static void open_new_blocks(cmark_parser *parser, cmark_node **container,
   bool has_content;
   int save_offset;
   int save_column;
+  unsigned char first_char;
 
   while (cont_type != CMARK_NODE_CODE_BLOCK &&
          cont_type != CMARK_NODE_HTML_BLOCK) {
 
     S_find_first_nonspace(parser, input);
     indented = parser->indent >= CODE_INDENT;
+    first_char = peek_at(input, parser->first_nonspace);
 
-    if (!indented && peek_at(input, parser->first_nonspace) == '>') {
+    if (!indented && first_char == '>') {
 
       bufsize_t blockquote_startpos = parser->first_nonspace;
 
@@ -1114,8 +1345,9 @@ static void open_new_blocks(cmark_parser *parser, cmark_node **container,
       *container = add_child(parser, *container, CMARK_NODE_BLOCK_QUOTE,
                              blockquote_startpos + 1);
 
-    } else if (!indented && (matched = scan_atx_heading_start(
-                                 input, parser->first_nonspace))) {
+    } else if (!indented && first_char == '#' &&
+               (matched = scan_atx_heading_start(
+                    S_scannable_line(parser, input), parser->first_nonspace))) {
       bufsize_t hashpos;
       int level = 0;
       bufsize_t heading_startpos = parser->first_nonspace;
@@ -1137,8 +1369,9 @@ static void open_new_blocks(cmark_parser *parser, cmark_node **container,
       (*container)->as.heading.setext = false;
       (*container)->internal_offset = matched;
 
-    } else if (!indented && (matched = scan_open_code_fence(
-                                 input, parser->first_nonspace))) {
+    } else if (!indented && (first_char == '`' || first_char == '~') &&
+               (matched = scan_open_code_fence(
+                    S_scannable_line(parser, input), parser->first_nonspace))) {
       *container = add_child(parser, *container, CMARK_NODE_CODE_BLOCK,
                              parser->first_nonspace + 1);
       (*container)->as.code.fenced = true;
@@ -1151,19 +1384,21 @@ static void open_new_blocks(cmark_parser *parser, cmark_node **container,
                        parser->first_nonspace + matched - parser->offset,
                        false);
 
-    } else if (!indented && ((matched = scan_html_block_start(
-                                  input, parser->first_nonspace)) ||
-                             (cont_type != CMARK_NODE_PARAGRAPH &&
-                              (matched = scan_html_block_start_7(
-                                   input, parser->first_nonspace))))) {
+    } else if (!indented && first_char == '<' &&
+               ((matched = scan_html_block_start(
+                     S_scannable_line(parser, input), parser->first_nonspace)) ||
+                (cont_type != CMARK_NODE_PARAGRAPH &&
+                 (matched = scan_html_block_start_7(
+                      input, parser->first_nonspace))))) {
       *container = add_child(parser, *container, CMARK_NODE_HTML_BLOCK,
                              parser->first_nonspace + 1);
       (*container)->as.html_block_type = matched;
       // note, we don't adjust parser->offset because the tag is part of the
       // text
     } else if (!indented && cont_type == CMARK_NODE_PARAGRAPH &&
-               (lev =
-                    scan_setext_heading_line(input, parser->first_nonspace))) {
+               (first_char == '=' || first_char == '-') &&
+               (lev = scan_setext_heading_line(
+                    S_scannable_line(parser, input), parser->first_nonspace))) {
       // finalize paragraph, resolving reference links
       has_content = resolve_reference_link_definitions(parser, *container);
 
@@ -1183,8 +1418,9 @@ static void open_new_blocks(cmark_parser *parser, cmark_node **container,
                              parser->first_nonspace + 1);
       S_advance_offset(parser, input, input->len - 1 - parser->offset, false);
     } else if (!indented &&
-               parser->options & CMARK_OPT_FOOTNOTES &&
-               (matched = scan_footnote_definition(input, parser->first_nonspace))) {
+               parser->options & CMARK_OPT_FOOTNOTES && first_char == '[' &&
+               (matched = scan_footnote_definition(
+                    S_scannable_line(parser, input), parser->first_nonspace))) {
       cmark_chunk c = cmark_chunk_dup(input, parser->first_nonspace + 2, matched - 2);
       cmark_chunk_to_cstr(parser->mem, &c);
 
@@ -1350,6 +1586,7 @@ static void add_text_to_container(cmark_parser *parser, cmark_node *container,
       add_line(container, input, parser);
     } else if (S_type(container) == CMARK_NODE_HTML_BLOCK) {
       add_line(container, input, parser);
+      S_scannable_line(parser, input);
 
       int matches_end_condition;
       switch (container->as.html_block_type) {
@@ -1421,16 +1658,30 @@ static void S_process_line(cmark_parser *parser, const unsigned char *buffer,
 
   cmark_strbuf_clear(&parser->curline);
 
-  if (parser->options & CMARK_OPT_VALIDATE_UTF8)
-    cmark_utf8proc_check(&parser->curline, buffer, bytes);
-  else
-    cmark_strbuf_put(&parser->curline, buffer, bytes);
+  if (bytes > 0 && buffer[bytes - 1] == '\n' &&
+      !(parser->options & CMARK_OPT_VALIDATE_UTF8) &&
+      parser->syntax_extensions == NULL) {
+    // The line is complete and needs no repair: parse it in place.
+    // Extensions are handed the line as a mutable buffer, so lines are
+    // always copied when any are attached.
+    parser->line.data = (unsigned char *)buffer;
+    parser->line.len = bytes;
+  } else {
+    if (parser->options & CMARK_OPT_VALIDATE_UTF8)
+      cmark_utf8proc_check(&parser->curline, buffer, bytes);
+    else
+      cmark_strbuf_put(&parser->curline, buffer, bytes);
+
+    bytes = parser->curline.size;
 
-  bytes = parser->curline.size;
+    // ensure line ends with a newline:
+    if (bytes == 0 || !S_is_line_end_char(parser->curline.ptr[bytes - 1]))
+      cmark_strbuf_putc(&parser->curline, '\n');
 
-  // ensure line ends with a newline:
-  if (bytes == 0 || !S_is_line_end_char(parser->curline.ptr[bytes - 1]))
-    cmark_strbuf_putc(&parser->curline, '\n');
+    parser->line.data = parser->curline.ptr;
+    parser->line.len = parser->curline.size;
+  }
+  parser->line.alloc = 0;
 
   parser->offset = 0;
   parser->column = 0;
@@ -1441,9 +1692,7 @@ static void S_process_line(cmark_parser *parser, const unsigned char *buffer,
   parser->blank = false;
   parser->partially_consumed_tab = false;
 
-  input.data = parser->curline.ptr;
-  input.len = parser->curline.size;
-  input.alloc = 0;
+  input = parser->line;
 
   // Skip UTF-8 BOM.
   if (parser->line_number == 0 &&
@@ -1478,23 +1727,18 @@ finished:
     parser->last_line_length -= 1;
 
   cmark_strbuf_clear(&parser->curline);
+  parser->line.data = NULL;
+  parser->line.len = 0;
+
+  if (S_streaming(parser))
+    S_stream_blocks(parser);
 }
 
-cmark_node *cmark_parser_finish(cmark_parser *parser) {
-  cmark_node *res;
+// Everything cmark_parser_finish() does once inlines have been parsed.
+static cmark_node *S_complete_document(cmark_parser *parser) {
+  cmark_node *res, *node;
   cmark_llist *extensions;
 
-  /* Parser was already finished once */
-  if (parser->root == NULL)
-    return NULL;
-
-  if (parser->linebuf.size) {
-    S_process_line(parser, parser->linebuf.ptr, parser->linebuf.size);
-    cmark_strbuf_clear(&parser->linebuf);
-  }
-
-  finalize_document(parser);
-
   cmark_consolidate_text_nodes(parser->root);
 
   cmark_strbuf_free(&parser->curline);
@@ -1515,14 +1759,547 @@ cmark_node *cmark_parser_finish(cmark_parser *parser) {
     }
   }
 
+  if (S_streaming(parser)) {
+    while ((node = parser->root->first_child) != NULL) {
+      if (parser->stream_mode == CMARK_STREAM_COLLECT_DEFINITIONS)
+        cmark_node_free(node);
+      else
+        S_emit_block(parser, node);
+    }
+  }
+
   res = parser->root;
   parser->root = NULL;
 
+  // Kept so that cmark_parser_reparse() can parse blocks of the document
+  // again without the rest of it.
+  if (!S_streaming(parser) && S_type(res) == CMARK_NODE_DOCUMENT) {
+    res->as.refmap = parser->refmap;
+    parser->refmap = NULL;
+  }
+
   cmark_parser_reset(parser);
 
   return res;
 }
 
+cmark_node *cmark_parser_finish(cmark_parser *parser) {
+  /* Parser was already finished once */
+  if (parser->root == NULL)
+    return NULL;
+
+  if (parser->linebuf.size) {
+    S_process_line(parser, parser->linebuf.ptr, parser->linebuf.size);
+    cmark_strbuf_clear(&parser->linebuf);
+  }
+
+  finalize_document(parser);
+
+  return S_complete_document(parser);
+}
+
+// Don't split documents smaller than this, or into pieces smaller than
+// a quarter of it.
+#define PARALLEL_BLOCKS_MIN_BYTES (1024 * 1024)
+
+typedef struct {
+  cmark_parser *parser;
+  const unsigned char *data;
+  size_t len;
+  bool eof;
+} block_segment;
+
+static void parse_block_segment(void *arg) {
+  block_segment *seg = (block_segment *)arg;
+  S_parser_feed(seg->parser, seg->data, seg->len, seg->eof);
+}
+
+// Blocks that blank lines do not end, by the text that starts and ends
+// them.  Tag names are matched regardless of case.
+static const struct {
+  const char *start;
+  const char *end;
+} LITERAL_BLOCKS[] = {
+    {"```", NULL},         {"~~~", NULL},         {"<!--", "-->"},
+    {"<?", "?>"},          {"<![CDATA[", "]]>"},  {"<script", "</script>"},
+    {"<pre", "</pre>"},    {"<style", "</style>"}, {"<textarea", "</textarea>"},
+};
+
+static bool S_match_ci(const unsigned char *p, const unsigned char *end,
+                       const char *s) {
+  for (; *s; ++p, ++s) {
+    if (p >= end || (*p | 0x20) != (*s | 0x20))
+      return false;
+  }
+  return true;
+}
+
+static bool S_line_contains(const unsigned char *p, const unsigned char *end,
+                            const char *s) {
+  for (; p < end; ++p) {
+    if (S_match_ci(p, end, s))
+      return true;
+  }
+  return false;
+}
+
+// Finds up to 'max' places to split the document in 'data', one at or
+// after each of the 'max' evenly spaced points, and returns how many it
+// found.  A split is made before a line that starts with an ASCII letter
+// and follows a blank line: such a line can only start a paragraph at
+// the top level, unless a block that blank lines do not end is open.
+// Top-level fenced code and literal HTML blocks are skipped here, but
+// this is only a guess; the parsers check it later.
+static int S_find_splits(const unsigned char *data, size_t len, int max,
+                         const unsigned char **splits) {
+  const unsigned char *p = data, *end = data + len, *eol, *q;
+  const char *closer = NULL;
+  size_t fence = 0, n;
+  bool blank, prev_blank = false;
+  int found = 0;
+  size_t i;
+
+  while (found < max &&
+         (eol = (const unsigned char *)memchr(p, '\n', (size_t)(end - p)))) {
+    for (q = p; q < eol && (*q == ' ' || *q == '\t' || *q == '\r'); ++q)
+      ;
+    blank = q == eol;
+    q = p;
+    while (q < eol && *q == ' ' && q - p < 3)
+      ++q;
+
+    if (fence) {
+      // a closing fence is a long enough run of the opening character
+      for (n = 0; q < eol && *q == closer[0]; ++n, ++q)
+        ;
+      while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r'))
+        ++q;
+      if (n >= fence && q == eol) {
+        fence = 0;
+        closer = NULL;
+      }
+    } else if (closer) {
+      if (S_line_contains(q, eol, closer))
+        closer = NULL;
+    } else if (prev_blank && cmark_isalpha(*p) &&
+               p >= data + len / (size_t)(max + 1) * (size_t)(found + 1)) {
+      splits[found++] = p;
+    } else {
+      for (i = 0; i < sizeof(LITERAL_BLOCKS) / sizeof(LITERAL_BLOCKS[0]); ++i) {
+        const char *opener = LITERAL_BLOCKS[i].start;
+        if (!S_match_ci(q, eol, opener))
+          continue;
+        if (!LITERAL_BLOCKS[i].end) {
+          closer = opener;
+          for (fence = 0; q + fence < eol && q[fence] == opener[0]; ++fence)
+            ;
+        } else if (!S_line_contains(q + strlen(opener), eol,
+                                    LITERAL_BLOCKS[i].end)) {
+          closer = LITERAL_BLOCKS[i].end;
+        }
+        break;
+      }
+    }
+
+    prev_blank = blank;
+    p = eol + 1;
+  }
+
+  return found;
+}
+
+// Whether a line starting with a letter at column 0 would begin a new
+// paragraph at the top level in the parser's current state, just as it
+// would in a fresh parser.
+static bool S_at_top_level_boundary(cmark_parser *parser) {
+  cmark_node *node = parser->root;
+
+  if (parser->linebuf.size)
+    return false;
+
+  while ((node = node->last_child) && (node->flags & CMARK_NODE__OPEN)) {
+    // Other containers only continue on indented or marked lines.
+    if (node->extension || S_type(node) == CMARK_NODE_PARAGRAPH ||
+        S_type(node) == CMARK_NODE_HTML_BLOCK ||
+        (S_type(node) == CMARK_NODE_CODE_BLOCK && node->as.code.fenced))
+      return false;
+  }
+
+  return true;
+}
+
+// Move 'node' and everything inside it 'line_offset' lines down.
+static void S_shift_lines(cmark_node *node, int line_offset) {
+  cmark_iter *iter;
+  cmark_event_type ev_type;
+  cmark_node *unknown = NULL;
+
+  if (!line_offset)
+    return;
+
+  iter = cmark_iter_new(node);
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    node = cmark_iter_get_node(iter);
+    // Line 0 stands for an unknown position; keep it that way.  The
+    // inlines of such a block are numbered from 0 as well.  A block
+    // closed by the line it started on may end on the line before.
+    if (unknown) {
+      if (node == unknown)
+        unknown = NULL;
+    } else if (ev_type == CMARK_EVENT_ENTER) {
+      if (node->start_line) {
+        node->start_line += line_offset;
+        node->end_line += line_offset;
+      } else if (node->first_child) {
+        unknown = node;
+      }
+    }
+  }
+  cmark_iter_free(iter);
+}
+
+// Close the blocks of a parser that parsed a later part of the document
+// starting at line 'line_offset' + 1, and append them to 'parser'.
+static void S_append_segment(cmark_parser *parser, cmark_parser *segment,
+                             int line_offset) {
+  cmark_node *node, *next;
+
+  if (segment->linebuf.size) {
+    S_process_line(segment, segment->linebuf.ptr, segment->linebuf.size);
+    cmark_strbuf_clear(&segment->linebuf);
+  }
+  close_blocks(segment);
+
+  for (node = segment->root->first_child; node; node = next) {
+    next = node->next;
+    S_shift_lines(node, line_offset);
+    cmark_node_append_child(parser->root, node);
+  }
+  parser->root->end_line = segment->root->end_line + line_offset;
+  parser->root->end_column = segment->root->end_column;
+
+  cmark_map_merge(parser->refmap, segment->refmap);
+  segment->refmap = NULL;
+}
+
+cmark_node *cmark_parser_parse_document(cmark_parser *parser,
+                                        const char *buffer, size_t len) {
+  const unsigned char *data = (const unsigned char *)buffer;
+  const unsigned char *end = data + len, **splits;
+  block_segment *segs;
+  cmark_llist *tmp;
+  cmark_parser *cur;
+  int nsegs = 0, max_segs, i, line_offset = 0;
+
+  max_segs = parser->threads;
+  if ((size_t)max_segs > len / (PARALLEL_BLOCKS_MIN_BYTES / 4))
+    max_segs = (int)(len / (PARALLEL_BLOCKS_MIN_BYTES / 4));
+
+  // Nodes made on other threads have to outlive them, which the arena
+  // allocator cannot do.  Only a fresh parser can be split.
+  if (max_segs < 2 || len < PARALLEL_BLOCKS_MIN_BYTES ||
+      parser->mem == cmark_get_arena_mem_allocator() || S_streaming(parser) ||
+      parser->line_number > 0 || parser->linebuf.size > 0) {
+    S_parser_feed(parser, data, len, true);
+    return cmark_parser_finish(parser);
+  }
+
+  segs = (block_segment *)parser->mem->calloc((size_t)max_segs,
+                                              sizeof(block_segment));
+  splits = (const unsigned char **)parser->mem->calloc(
+      (size_t)max_segs, sizeof(const unsigned char *));
+  nsegs = S_find_splits(data, len, max_segs - 1, splits) + 1;
+  for (i = 0; i < nsegs; ++i) {
+    segs[i].data = i ? splits[i - 1] : data;
+    segs[i].len = (size_t)((i + 1 < nsegs ? splits[i] : end) - segs[i].data);
+  }
+  segs[0].parser = parser;
+  segs[nsegs - 1].eof = true;
+  parser->mem->free(splits);
+
+  for (i = 1; i < nsegs; ++i) {
+    cmark_parser *seg = cmark_parser_new_with_mem(parser->options, parser->mem);
+    for (tmp = parser->syntax_extensions; tmp; tmp = tmp->next)
+      cmark_parser_attach_syntax_extension(
+          seg, (cmark_syntax_extension *)tmp->data);
+    seg->backslash_ispunct = parser->backslash_ispunct;
+    segs[i].parser = seg;
+  }
+
+  cmark_parallel_run(parse_block_segment, segs, sizeof(block_segment), nsegs);
+
+  // A segment parsed on its own is only valid if the parser before it
+  // ended up at a top-level boundary.  Otherwise feed its text to that
+  // parser instead, as the serial parse would have.
+  cur = parser;
+  for (i = 1; i < nsegs; ++i) {
+    if (S_at_top_level_boundary(cur)) {
+      if (cur == parser) {
+        close_blocks(parser);
+      } else {
+        S_append_segment(parser, cur, line_offset);
+      }
+      line_offset += cur->line_number;
+      if (cur != parser)
+        cmark_parser_free(cur);
+      cur = segs[i].parser;
+    } else {
+      S_parser_feed(cur, segs[i].data, segs[i].len, segs[i].eof);
+      cmark_parser_free(segs[i].parser);
+    }
+  }
+
+  if (cur == parser) {
+    if (parser->linebuf.size) {
+      S_process_line(parser, parser->linebuf.ptr, parser->linebuf.size);
+      cmark_strbuf_clear(&parser->linebuf);
+    }
+    close_blocks(parser);
+  } else {
+    S_append_segment(parser, cur, line_offset);
+    cmark_parser_free(cur);
+  }
+  parser->mem->free(segs);
+
+  process_inlines(parser, parser->refmap, parser->options);
+  if (parser->options & CMARK_OPT_FOOTNOTES)
+    process_footnotes(parser);
+
+  return S_complete_document(parser);
+}
+
+// Returns the position after the next 'count' line endings from 'pos',
+// or 'len' if there are fewer.
+static size_t S_skip_lines(const unsigned char *data, size_t len, size_t pos,
+                           int count) {
+  const unsigned char *p = data + pos, *end = data + len;
+
+  while (count-- > 0) {
+    p = cmark_simd_find3(p, end, '\n', '\r', '\n');
+    if (p == end)
+      break;
+    if (*p == '\r' && p + 1 < end && p[1] == '\n')
+      ++p;
+    ++p;
+  }
+  return (size_t)(p - data);
+}
+
+static int S_count_lines(const unsigned char *data, size_t len) {
+  const unsigned char *p = data, *end = data + len;
+  int count = 0;
+
+  while ((p = cmark_simd_find3(p, end, '\n', '\r', '\n')) < end) {
+    if (*p == '\r' && p + 1 < end && p[1] == '\n')
+      ++p;
+    ++p;
+    ++count;
+  }
+  return count;
+}
+
+static bool S_at_line_start(const unsigned char *data, size_t len,
+                            size_t pos) {
+  return pos == 0 || data[pos - 1] == '\n' ||
+         (data[pos - 1] == '\r' && (pos == len || data[pos] != '\n'));
+}
+
+// Whether the line before the one starting at 'pos' is blank.
+static bool S_follows_blank_line(const unsigned char *data, size_t pos) {
+  if (pos == 0)
+    return false;
+  if (data[pos - 1] == '\n')
+    --pos;
+  if (pos && data[pos - 1] == '\r')
+    --pos;
+  while (pos && (data[pos - 1] == ' ' || data[pos - 1] == '\t'))
+    --pos;
+  return pos == 0 || data[pos - 1] == '\n' || data[pos - 1] == '\r';
+}
+
+// Whether the blocks in 'data' define the same links, in the same order,
+// as the blocks 'parser' has just closed.
+static bool S_same_definitions(cmark_parser *parser, const unsigned char *data,
+                               size_t len) {
+  cmark_parser *old = cmark_parser_new_with_mem(parser->options, parser->mem);
+  cmark_llist *tmp;
+  bool same;
+
+  for (tmp = parser->syntax_extensions; tmp; tmp = tmp->next)
+    cmark_parser_attach_syntax_extension(
+        old, (cmark_syntax_extension *)tmp->data);
+  old->backslash_ispunct = parser->backslash_ispunct;
+
+  S_parser_feed(old, data, len, true);
+  if (old->linebuf.size) {
+    S_process_line(old, old->linebuf.ptr, old->linebuf.size);
+    cmark_strbuf_clear(&old->linebuf);
+  }
+  close_blocks(old);
+
+  same = cmark_reference_maps_equal(parser->refmap, old->refmap);
+  cmark_parser_free(old);
+  return same;
+}
+
+// Blocks that extensions split off from the one after them, such as the
+// paragraph before a table, are left at line 0.  Returns the first of
+// those in front of 'node', or 'node'.
+static cmark_node *S_first_of_group(cmark_node *node) {
+  while (node && node->prev && node->prev->start_line == 0)
+    node = node->prev;
+  return node;
+}
+
+cmark_node *cmark_parser_reparse(cmark_parser *parser, cmark_node *document,
+                                 const char *old_buffer, size_t old_len,
+                                 const char *buffer, size_t len,
+                                 size_t offset, size_t removed) {
+  const unsigned char *old = (const unsigned char *)old_buffer;
+  const unsigned char *data = (const unsigned char *)buffer;
+  cmark_node *restart = NULL, *resume = NULL, *node, *next, *region;
+  size_t inserted, start = 0, pos = 0, fed, end, old_end;
+  int edit_line, line = 1, restart_line = 1, delta = 0;
+
+  // Footnotes are numbered across the whole document, so parse
+  // everything again when they are enabled.
+  if (document == NULL || S_type(document) != CMARK_NODE_DOCUMENT ||
+      document->as.refmap == NULL || offset > old_len ||
+      removed > old_len - offset || len + removed < old_len ||
+      parser->line_number > 0 || parser->linebuf.size > 0 ||
+      S_streaming(parser) || (parser->options & CMARK_OPT_FOOTNOTES)) {
+    if (document)
+      cmark_node_free(document);
+    return cmark_parser_parse_document(parser, buffer, len);
+  }
+
+  inserted = len + removed - old_len;
+  edit_line = S_count_lines(data, offset) + 1;
+
+  // Start from the last top-level block before the edit that begins the
+  // document or follows a blank line.  Everything before it was closed
+  // by that line, which the edit left alone, so a fresh parser started
+  // there sees what the parser of the whole document would.
+  for (node = document->first_child; node; node = node->next) {
+    if (node->start_line >= edit_line)
+      break;
+    if (node->start_line <= line)
+      continue;
+    pos = S_skip_lines(data, len, pos, node->start_line - line);
+    line = node->start_line;
+    if (S_follows_blank_line(data, pos)) {
+      restart = node;
+      restart_line = line;
+      start = pos;
+    }
+  }
+  if (!restart) {
+    restart = document->first_child;
+    restart_line = 1;
+    start = 0;
+  }
+
+  // Parse up to the first later block that starts a paragraph after a
+  // blank line, once the edit is behind us and the new text has brought
+  // the parser back to the top level there too.  That block, and all
+  // those after it, come out the same as before, just moved.
+  // A block closed by the line it started on ends at the line before.
+  pos = start;
+  if (pos > 0 && data[pos - 1] == '\n')
+    --pos;
+  if (pos > 0 && data[pos - 1] == '\r')
+    --pos;
+  for (fed = pos; pos > 0 && data[pos - 1] != '\n' && data[pos - 1] != '\r';)
+    --pos;
+  parser->last_line_length = (bufsize_t)(fed - pos);
+
+  pos = fed = start;
+  line = restart_line;
+  for (node = restart ? restart->next : NULL; node; node = node->next) {
+    size_t resume_pos;
+
+    if (node->start_line <= line)
+      continue;
+    pos = S_skip_lines(old, old_len, pos, node->start_line - line);
+    line = node->start_line;
+    if (pos >= old_len)
+      break;
+    if (pos < offset + removed || !cmark_isalpha(old[pos]) ||
+        !S_follows_blank_line(old, pos))
+      continue;
+
+    resume_pos = pos - removed + inserted;
+    if (!S_at_line_start(data, len, resume_pos) ||
+        !S_follows_blank_line(data, resume_pos))
+      continue;
+
+    S_parser_feed(parser, data + fed, resume_pos - fed, false);
+    fed = resume_pos;
+    if (S_at_top_level_boundary(parser)) {
+      resume = node;
+      delta = restart_line + parser->line_number - line;
+      break;
+    }
+  }
+  if (resume) {
+    end = fed;
+    old_end = pos;
+  } else {
+    if (fed < len)
+      S_parser_feed(parser, data + fed, len - fed, true);
+    end = len;
+    old_end = old_len;
+  }
+
+  if (parser->linebuf.size) {
+    S_process_line(parser, parser->linebuf.ptr, parser->linebuf.size);
+    cmark_strbuf_clear(&parser->linebuf);
+  }
+  close_blocks(parser);
+
+  // Definitions are global: one added, removed or changed can change
+  // links in untouched blocks.  Parse everything again only then; the
+  // new blocks get the definitions of the whole document.
+  if ((cmark_may_define_labels(data + start, end - start) ||
+       cmark_may_define_labels(old + start, old_end - start)) &&
+      !S_same_definitions(parser, old + start, old_end - start)) {
+    cmark_strbuf_free(&parser->curline);
+    cmark_strbuf_free(&parser->linebuf);
+    cmark_parser_reset(parser);
+    cmark_node_free(document);
+    return cmark_parser_parse_document(parser, buffer, len);
+  }
+  process_inlines(parser, document->as.refmap, parser->options);
+  region = S_complete_document(parser);
+  restart = S_first_of_group(restart);
+  resume = S_first_of_group(resume);
+
+  for (node = restart; node != resume; node = next) {
+    next = node->next;
+    cmark_node_free(node);
+  }
+  for (node = region->first_child; node; node = next) {
+    next = node->next;
+    S_shift_lines(node, restart_line - 1);
+    if (resume)
+      cmark_node_insert_before(resume, node);
+    else
+      cmark_node_append_child(document, node);
+  }
+
+  if (resume) {
+    for (node = resume; node; node = node->next)
+      S_shift_lines(node, delta);
+    document->end_line += delta;
+  } else {
+    document->end_line = region->end_line + restart_line - 1;
+    document->end_column = region->end_column;
+  }
+  cmark_node_free(region);
+
+  return document;
+}
+
 int cmark_parser_get_line_number(cmark_parser *parser) {
   return parser->line_number;
 }
@@ -119,6 +119,49 @@ void cmark_strbuf_puts(cmark_strbuf *buf, const char *string) {
   cmark_strbuf_put(buf, (const unsigned char *)string, (bufsize_t)strlen(string));
 }
 
+static const char DIGIT_PAIRS[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+bufsize_t cmark_int_to_cstr(char *data, int n) {
+  char digits[CMARK_INT_BUFSIZE];
+  char *p = digits + sizeof(digits);
+  unsigned int u = n < 0 ? 0u - (unsigned int)n : (unsigned int)n;
+  bufsize_t len;
+
+  // Two digits at a time, from the right.
+  while (u >= 100) {
+    p -= 2;
+    memcpy(p, DIGIT_PAIRS + (u % 100) * 2, 2);
+    u /= 100;
+  }
+  if (u >= 10) {
+    p -= 2;
+    memcpy(p, DIGIT_PAIRS + u * 2, 2);
+  } else {
+    *--p = (char)('0' + u);
+  }
+  if (n < 0)
+    *--p = '-';
+
+  len = (bufsize_t)(digits + sizeof(digits) - p);
+  memcpy(data, p, len);
+  data[len] = '\0';
+  return len;
+}
+
+void cmark_strbuf_put_int(cmark_strbuf *buf, int n) {
+  S_strbuf_grow_by(buf, CMARK_INT_BUFSIZE);
+  buf->size += cmark_int_to_cstr((char *)buf->ptr + buf->size, n);
+}
+
 void cmark_strbuf_copy_cstr(char *data, bufsize_t datasize,
                             const cmark_strbuf *buf) {
   bufsize_t copylen;
@@ -82,6 +82,22 @@ void cmark_strbuf_put(cmark_strbuf *buf, const unsigned char *data,
 CMARK_GFM_EXPORT
 void cmark_strbuf_puts(cmark_strbuf *buf, const char *string);
 
+// Enough room for the decimal form of any int, with its sign and a NUL.
+#define CMARK_INT_BUFSIZE 12
+
+/**
+ * Write the decimal form of `n`, NUL-terminated, to `data`, which must
+ * hold CMARK_INT_BUFSIZE bytes, and return its length.
+ */
+CMARK_GFM_EXPORT
+bufsize_t cmark_int_to_cstr(char *data, int n);
+
+/**
+ * Append the decimal form of `n`, without going through printf.
+ */
+CMARK_GFM_EXPORT
+void cmark_strbuf_put_int(cmark_strbuf *buf, int n);
+
 CMARK_GFM_EXPORT
 void cmark_strbuf_clear(cmark_strbuf *buf);
 
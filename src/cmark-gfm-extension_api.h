@@ -249,6 +249,16 @@ typedef int (*cmark_html_filter_func) (cmark_syntax_extension *extension,
                                        const unsigned char *tag,
                                        size_t tag_len);
 
+/** Called once parsing is complete, with 'root' and its inlines parsed,
+ * to change the tree in place.  'root' is normally the document node,
+ * which the returned node, if not NULL, replaces.
+ *
+ * When the parser streams blocks (see cmark_parser_set_block_callback()),
+ * it is called instead for each top-level block before the block is
+ * passed on, with the block as 'root', still in the document.  The
+ * return value is then ignored: the blocks found in its place in the
+ * document afterwards are passed on.
+ */
 typedef cmark_node *(*cmark_postprocess_func) (cmark_syntax_extension *extension,
                                                cmark_parser *parser,
                                                cmark_node *root);
@@ -263,6 +273,24 @@ typedef void (*cmark_opaque_free_func) (cmark_syntax_extension *extension,
                                         cmark_mem *mem,
                                         cmark_node *node);
 
+/** Should pass the opaque data of 'node' on to 'write', for
+ * cmark_node_serialize().  Returns 0, or the value of a failed write.
+ */
+typedef int (*cmark_opaque_serialize_func) (cmark_syntax_extension *extension,
+                                            cmark_node *node,
+                                            cmark_write_func write,
+                                            void *userdata);
+
+/** Should restore the opaque data of 'node', already set up by the
+ * 'cmark_opaque_alloc_func', from the 'len' bytes at 'data' written by
+ * the 'cmark_opaque_serialize_func'.  Returns 0 on success.
+ */
+typedef int (*cmark_opaque_deserialize_func) (cmark_syntax_extension *extension,
+                                              cmark_mem *mem,
+                                              cmark_node *node,
+                                              const unsigned char *data,
+                                              size_t len);
+
 /** Free a cmark_syntax_extension.
  */
 CMARK_GFM_EXPORT
@@ -405,6 +433,18 @@ CMARK_GFM_EXPORT
 void cmark_syntax_extension_set_opaque_free_func(cmark_syntax_extension *extension,
                                                  cmark_opaque_free_func func);
 
+/** See the documentation for 'cmark_syntax_extension'
+ */
+CMARK_GFM_EXPORT
+void cmark_syntax_extension_set_opaque_serialize_func(cmark_syntax_extension *extension,
+                                                      cmark_opaque_serialize_func func);
+
+/** See the documentation for 'cmark_syntax_extension'
+ */
+CMARK_GFM_EXPORT
+void cmark_syntax_extension_set_opaque_deserialize_func(cmark_syntax_extension *extension,
+                                                        cmark_opaque_deserialize_func func);
+
 /** See the documentation for 'cmark_syntax_extension'
  */
 CMARK_GFM_EXPORT
@@ -717,6 +757,13 @@ int cmark_inline_parser_scan_delimiters(cmark_inline_parser *parser,
                                   int *punct_before,
                                   int *punct_after);
 
+/** Rebuilds the inline special characters of 'parser', including the
+ * characters of its attached inline extensions if 'add' is non-zero, or
+ * only the core ones otherwise.  The tables belong to the parser and are
+ * kept up to date by cmark_parser_attach_syntax_extension(), so this is
+ * only needed after changing the special characters of an attached
+ * extension.
+ */
 CMARK_GFM_EXPORT
 void cmark_manage_extensions_special_characters(cmark_parser *parser, int add);
 
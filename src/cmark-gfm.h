@@ -28,6 +28,25 @@ extern "C" {
 CMARK_GFM_EXPORT
 char *cmark_markdown_to_html(const char *text, size_t len, int options);
 
+/** Receives 'len' bytes of output at 'data', along with the 'userdata'
+ * given with it.  Returns 0 on success; anything else stops the output.
+ */
+typedef int (*cmark_write_func)(const char *data, size_t len, void *userdata);
+
+/** Convert 'text' like cmark_markdown_to_html(), but render each
+ * top-level block as soon as it has been parsed and pass the HTML on to
+ * 'write' in pieces, without ever building the whole document tree.
+ * Only CMARK_OPT_FOOTNOTES needs the complete tree.  Returns 0, or the
+ * value of the 'write' call that stopped the output.
+ *
+ * Links may come before the definitions they use.  If 'text' contains
+ * "]:" anywhere, it is therefore parsed into blocks twice: once to
+ * collect the definitions, and once more to render it.
+ */
+CMARK_GFM_EXPORT
+int cmark_markdown_to_html_stream(const char *text, size_t len, int options,
+                                  cmark_write_func write, void *userdata);
+
 /** ## Node Structure
  */
 
@@ -115,6 +134,10 @@ cmark_mem *cmark_get_default_mem_allocator();
 
 /** An arena allocator; uses system calloc to allocate large
  * slabs of memory.  Memory in these slabs is not reused at all.
+ * Allocations go to the calling thread's current arena (see
+ * 'cmark_arena_set_current').  A thread's default arena is freed when
+ * the thread exits, where the platform's threads allow it; elsewhere
+ * call 'cmark_arena_reset' before a thread that used it ends.
  */
 CMARK_GFM_EXPORT
 cmark_mem *cmark_get_arena_mem_allocator();
@@ -125,6 +148,65 @@ cmark_mem *cmark_get_arena_mem_allocator();
 CMARK_GFM_EXPORT
 void cmark_arena_reset(void);
 
+/** An arena object.  Each thread allocates through its own current
+ * arena; by default this is a thread-local arena that is managed with
+ * 'cmark_arena_reset'.  Binding an explicit arena to a thread with
+ * 'cmark_arena_set_current' lets worker threads recycle their memory
+ * document after document without sharing any state.
+ */
+typedef struct cmark_arena cmark_arena;
+
+/** Memory usage of an arena, as reported by 'cmark_arena_get_stats'.
+ */
+typedef struct cmark_arena_stats {
+  size_t chunks;     /* number of slabs held by the arena */
+  size_t capacity;   /* total size of those slabs, in bytes */
+  size_t used;       /* bytes handed out since the arena was last cleared */
+  size_t high_water; /* decaying peak of 'used' across clears */
+  size_t wasted;     /* bytes abandoned by reallocations since last clear */
+} cmark_arena_stats;
+
+/** Creates a new, empty arena.  No memory is reserved until the
+ * arena is first allocated from.
+ */
+CMARK_GFM_EXPORT
+cmark_arena *cmark_arena_new(void);
+
+/** Frees 'arena' and all memory allocated from it.  If 'arena' is
+ * bound to the calling thread, the thread reverts to its default arena.
+ */
+CMARK_GFM_EXPORT
+void cmark_arena_free(cmark_arena *arena);
+
+/** Makes 'arena' the target of 'cmark_get_arena_mem_allocator' for
+ * the calling thread and returns the previously bound arena.  Pass NULL
+ * to go back to the thread's default arena.  The binding must not change
+ * while a document allocated from the arena is still in use.
+ *
+ * Growing a block with the allocator's realloc moves it into whichever
+ * arena is current at that point.  A buffer that grows after the binding
+ * changed then belongs to the new arena, and no longer to the one it was
+ * first allocated from.
+ */
+CMARK_GFM_EXPORT
+cmark_arena *cmark_arena_set_current(cmark_arena *arena);
+
+/** Releases everything allocated from 'arena' (or from the calling
+ * thread's current arena, if NULL), but keeps enough slabs mapped
+ * for the next document, re-zeroing only the bytes that were used.
+ * The retained capacity follows a high-water mark of recent
+ * documents, so memory taken by an occasional large document is
+ * released again over the following clears.
+ */
+CMARK_GFM_EXPORT
+void cmark_arena_clear(cmark_arena *arena);
+
+/** Fills in 'stats' for 'arena' (or for the calling thread's current
+ * arena, if NULL).
+ */
+CMARK_GFM_EXPORT
+void cmark_arena_get_stats(cmark_arena *arena, cmark_arena_stats *stats);
+
 /** Callback for freeing user data with a 'cmark_mem' context.
  */
 typedef void (*cmark_free_func) (cmark_mem *mem, void *user_data);
@@ -195,7 +277,15 @@ CMARK_GFM_EXPORT cmark_node *cmark_node_new_with_mem_and_ext(cmark_node_type typ
                                                 cmark_mem *mem,
                                                 cmark_syntax_extension *extension);
 
-/** Frees the memory allocated for a node and any children.
+/** Frees the memory allocated for a node and any children.  The nodes
+ * of a parsed document share memory that is returned once all of them
+ * are freed, so they must not be freed from several threads at once.
+ *
+ * Once parsing has finished, the memory of freed nodes is not reused
+ * either, and keeping a single node of a parsed document keeps the
+ * memory of all its nodes.  To hold on to
+ * part of a large document for long, build a copy of it with
+ * cmark_node_new() and free the parsed document.
  */
 CMARK_GFM_EXPORT void cmark_node_free(cmark_node *node);
 
@@ -494,7 +584,9 @@ CMARK_GFM_EXPORT int cmark_node_get_end_column(cmark_node *node);
  */
 
 /** Unlinks a 'node', removing it from the tree, but not freeing its
- * memory.  (Use 'cmark_node_free' for that.)
+ * memory.  (Use 'cmark_node_free' for that.)  A node unlinked from a
+ * parsed document still keeps the memory of the whole document, see
+ * cmark_node_free().
  */
 CMARK_GFM_EXPORT void cmark_node_unlink(cmark_node *node);
 
@@ -568,6 +660,65 @@ cmark_parser *cmark_parser_new_with_mem(int options, cmark_mem *mem);
 CMARK_GFM_EXPORT
 void cmark_parser_free(cmark_parser *parser);
 
+/** Lets 'parser' spread the inline parsing of large documents over up
+ * to 'threads' threads, once all blocks and link reference definitions
+ * have been parsed, and cmark_parser_parse_document() split block
+ * parsing as well.  The default of 1 parses everything on the calling
+ * thread.
+ *
+ * The parser's memory allocator and the inline callbacks of its syntax
+ * extensions must be safe to call from several threads at once.  The
+ * arena allocator is bound to the calling thread, so parsers using it
+ * always parse inlines on the calling thread.
+ */
+CMARK_GFM_EXPORT
+void cmark_parser_set_threads(cmark_parser *parser, int threads);
+
+/** Called with a document holding one top-level block of a document
+ * being streamed, see cmark_parser_set_block_callback().
+ */
+typedef void (*cmark_block_callback)(cmark_node *document, void *data);
+
+/** How a streaming parser deals with link reference definitions, which
+ * may come after the links that use them.
+ */
+typedef enum {
+  /** Links only use the definitions that come before them. */
+  CMARK_STREAM_DEFINED_SO_FAR,
+  /** The first block with a link label that nothing has defined yet is
+   * held back until the end of the document, along with every block
+   * after it.  Blocks come out exactly as from a regular parse.
+   */
+  CMARK_STREAM_WAIT_FOR_DEFINITIONS,
+  /** The first of two passes over the same text.  Blocks are dropped
+   * as soon as they are complete and the callback is not called; the
+   * definitions are kept past cmark_parser_finish() for the second
+   * pass, which can then use CMARK_STREAM_DEFINED_SO_FAR and get blocks
+   * exactly as from a regular parse.
+   */
+  CMARK_STREAM_COLLECT_DEFINITIONS
+} cmark_stream_mode;
+
+/** Makes 'parser' hand every top-level block to 'callback' as soon as
+ * nothing later in the document can change it, with its inlines parsed,
+ * instead of keeping it in the document.  The block is passed in a
+ * document node of its own, which belongs to the callback: it can be
+ * rendered like any document and must be freed with cmark_node_free().
+ * This keeps the memory needed to convert a document independent of its
+ * length.  'data' is passed on to 'callback'; 'mode' says how to handle
+ * link reference definitions.
+ *
+ * cmark_parser_finish() passes on the remaining blocks and returns an
+ * empty document.  Footnotes are not numbered or moved to the end of
+ * the document.  A NULL 'callback' turns streaming off again, except in
+ * CMARK_STREAM_COLLECT_DEFINITIONS mode.  Set this before feeding the
+ * parser anything.
+ */
+CMARK_GFM_EXPORT
+void cmark_parser_set_block_callback(cmark_parser *parser,
+                                     cmark_block_callback callback,
+                                     void *data, cmark_stream_mode mode);
+
 /** Feeds a string of length 'len' to 'parser'.
  */
 CMARK_GFM_EXPORT
@@ -578,6 +729,43 @@ void cmark_parser_feed(cmark_parser *parser, const char *buffer, size_t len);
 CMARK_GFM_EXPORT
 cmark_node *cmark_parser_finish(cmark_parser *parser);
 
+/** Parses the complete document in 'buffer' of length 'len' with
+ * 'parser', which must not have been fed anything yet, and returns it
+ * like cmark_parser_finish().
+ *
+ * If cmark_parser_set_threads() allows it, large documents are split
+ * into pieces before lines that start a top-level paragraph, and the
+ * pieces are parsed on separate threads before being joined.  The
+ * result is the same tree cmark_parser_feed() and cmark_parser_finish()
+ * would give.
+ */
+CMARK_GFM_EXPORT
+cmark_node *cmark_parser_parse_document(cmark_parser *parser,
+                                        const char *buffer, size_t len);
+
+/** Parses the document in 'buffer' of length 'len' with 'parser',
+ * which must not have been fed anything yet, given 'document', the tree
+ * parsed from 'old_buffer' of length 'old_len' with the same options
+ * and extensions, and that 'buffer' is 'old_buffer' with the 'removed'
+ * bytes at 'offset' replaced by something else.
+ *
+ * Only the top-level blocks around the edit are parsed again; the nodes
+ * of the others are kept and their source positions moved.  The whole
+ * document is parsed again when the edit could change more than that:
+ * when the blocks parsed again define other link references than they
+ * did before, and always with CMARK_OPT_FOOTNOTES.  Either way the
+ * result is the tree cmark_parser_feed() and cmark_parser_finish() would
+ * give for 'buffer'.
+ *
+ * Returns the new document, which is 'document' itself when it could be
+ * updated in place.  'document' must not be used afterwards.
+ */
+CMARK_GFM_EXPORT
+cmark_node *cmark_parser_reparse(cmark_parser *parser, cmark_node *document,
+                                 const char *old_buffer, size_t old_len,
+                                 const char *buffer, size_t len,
+                                 size_t offset, size_t removed);
+
 /** Parse a CommonMark document in 'buffer' of length 'len'.
  * Returns a pointer to a tree of nodes.  The memory allocated for
  * the node tree should be released using 'cmark_node_free'
@@ -597,6 +785,22 @@ cmark_node *cmark_parse_file(FILE *f, int options);
  * ## Rendering
  */
 
+/** Where the '*_to_sink' renderers send their output: rather than
+ * returning one string, they collect about 'chunk_size' bytes at a time
+ * (or a default amount if it is 0) and pass them on to 'write' along
+ * with 'userdata'.
+ */
+typedef struct cmark_sink {
+  cmark_write_func write;
+  void *userdata;
+  size_t chunk_size;
+} cmark_sink;
+
+/** A cmark_write_func that writes to the 'FILE *' given as 'userdata'.
+ */
+CMARK_GFM_EXPORT
+int cmark_write_file(const char *data, size_t len, void *userdata);
+
 /** Render a 'node' tree as XML.  It is the caller's responsibility
  * to free the returned buffer.
  */
@@ -609,6 +813,12 @@ char *cmark_render_xml(cmark_node *root, int options);
 CMARK_GFM_EXPORT
 char *cmark_render_xml_with_mem(cmark_node *root, int options, cmark_mem *mem);
 
+/** As for 'cmark_render_xml', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_xml_to_sink(cmark_node *root, int options, cmark_sink *sink);
+
 /** Render a 'node' tree as an HTML fragment.  It is up to the user
  * to add an appropriate header and footer. It is the caller's
  * responsibility to free the returned buffer.
@@ -622,6 +832,28 @@ char *cmark_render_html(cmark_node *root, int options, cmark_llist *extensions);
 CMARK_GFM_EXPORT
 char *cmark_render_html_with_mem(cmark_node *root, int options, cmark_llist *extensions, cmark_mem *mem);
 
+/** As for 'cmark_render_html', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_html_to_sink(cmark_node *root, int options, cmark_llist *extensions, cmark_sink *sink);
+
+/** As for 'cmark_render_html', but writing into the 'capacity' bytes at
+ * 'buffer', like snprintf: output that does not fit is cut off, and the
+ * result is NUL-terminated unless 'capacity' is 0.  Returns the length of
+ * the whole output, so a result of 'capacity' or more means 'buffer' was
+ * too small.
+ */
+CMARK_GFM_EXPORT
+size_t cmark_render_html_to_buffer(cmark_node *root, int options, cmark_llist *extensions, char *buffer, size_t capacity);
+
+/** Estimate, without rendering it, how many bytes of HTML 'root' will
+ * render to, so that an output buffer can be sized once.  The estimate
+ * leaves some room for escaping but is not an upper bound.
+ */
+CMARK_GFM_EXPORT
+size_t cmark_render_html_estimate(cmark_node *root, int options);
+
 /** Render a 'node' tree as a groff man page, without the header.
  * It is the caller's responsibility to free the returned buffer.
  */
@@ -634,6 +866,12 @@ char *cmark_render_man(cmark_node *root, int options, int width);
 CMARK_GFM_EXPORT
 char *cmark_render_man_with_mem(cmark_node *root, int options, int width, cmark_mem *mem);
 
+/** As for 'cmark_render_man', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_man_to_sink(cmark_node *root, int options, int width, cmark_sink *sink);
+
 /** Render a 'node' tree as a commonmark document.
  * It is the caller's responsibility to free the returned buffer.
  */
@@ -646,6 +884,12 @@ char *cmark_render_commonmark(cmark_node *root, int options, int width);
 CMARK_GFM_EXPORT
 char *cmark_render_commonmark_with_mem(cmark_node *root, int options, int width, cmark_mem *mem);
 
+/** As for 'cmark_render_commonmark', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_commonmark_to_sink(cmark_node *root, int options, int width, cmark_sink *sink);
+
 /** Render a 'node' tree as a plain text document.
  * It is the caller's responsibility to free the returned buffer.
  */
@@ -658,6 +902,12 @@ char *cmark_render_plaintext(cmark_node *root, int options, int width);
 CMARK_GFM_EXPORT
 char *cmark_render_plaintext_with_mem(cmark_node *root, int options, int width, cmark_mem *mem);
 
+/** As for 'cmark_render_plaintext', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_plaintext_to_sink(cmark_node *root, int options, int width, cmark_sink *sink);
+
 /** Render a 'node' tree as a LaTeX document.
  * It is the caller's responsibility to free the returned buffer.
  */
@@ -670,6 +920,43 @@ char *cmark_render_latex(cmark_node *root, int options, int width);
 CMARK_GFM_EXPORT
 char *cmark_render_latex_with_mem(cmark_node *root, int options, int width, cmark_mem *mem);
 
+/** As for 'cmark_render_latex', but passing the output on to 'sink'.
+ * Returns 0, or the value of the write that stopped the output.
+ */
+CMARK_GFM_EXPORT
+int cmark_render_latex_to_sink(cmark_node *root, int options, int width, cmark_sink *sink);
+
+/**
+ * ## Serialization
+ */
+
+/** Serialize the tree under 'root' to a compact binary form, passing it
+ * on to 'write' in pieces.  The result can be turned back into a tree
+ * with 'cmark_node_deserialize', in this process or another one using
+ * the same version of the library on the same platform.  Returns 0, or
+ * the value of a failed write, or -1 if the tree holds nodes that cannot
+ * be serialized.
+ */
+CMARK_GFM_EXPORT
+int cmark_node_serialize(cmark_node *root, cmark_write_func write,
+                         void *userdata);
+
+/** Rebuild a tree from the 'len' bytes at 'data' written by
+ * 'cmark_node_serialize', or return NULL if they do not hold one.  The
+ * strings of the tree point into 'data', which must stay unchanged
+ * until the tree is freed: it can be a read-only mmap of a cache file.
+ * Nodes made by an extension need that extension to be registered.
+ */
+CMARK_GFM_EXPORT
+cmark_node *cmark_node_deserialize(const void *data, size_t len);
+
+/** As for 'cmark_node_deserialize', but specifying the allocator to use
+ * for the nodes.
+ */
+CMARK_GFM_EXPORT
+cmark_node *cmark_node_deserialize_with_mem(const void *data, size_t len,
+                                            cmark_mem *mem);
+
 /**
  * ## Options
  */
@@ -13,11 +13,13 @@
 #include "render.h"
 #include "syntax_extension.h"
 
-#define OUT(s, wrap, escaping) renderer->out(renderer, node, s, wrap, escaping)
-#define LIT(s) renderer->out(renderer, node, s, false, LITERAL)
+#define OUT(s, wrap, escaping) cmark_render_out(renderer, node, s, wrap, escaping)
+#define OUT_LEN(s, len, wrap, escaping)                                        \
+  renderer->out_len(renderer, node, (const char *)(s), (bufsize_t)(len), wrap, \
+                    escaping)
+#define LIT(s) cmark_render_out(renderer, node, s, false, LITERAL)
 #define CR() renderer->cr(renderer)
 #define BLANKLINE() renderer->blankline(renderer)
-#define ENCODED_SIZE 20
 #define LISTMARKER_SIZE 20
 
 // Functions to convert cmark_nodes to commonmark strings.
@@ -29,7 +31,6 @@ static CMARK_INLINE void outc(cmark_renderer *renderer, cmark_node *node,
   bool follows_digit =
       renderer->buffer->size > 0 &&
       cmark_isdigit(renderer->buffer->ptr[renderer->buffer->size - 1]);
-  char encoded[ENCODED_SIZE];
 
   needs_escaping =
       c < 0x80 && escape != LITERAL &&
@@ -53,16 +54,19 @@ static CMARK_INLINE void outc(cmark_renderer *renderer, cmark_node *node,
   if (needs_escaping) {
     if (escape == URL && cmark_isspace((char)c)) {
       // use percent encoding for spaces
-      snprintf(encoded, ENCODED_SIZE, "%%%2X", c);
-      cmark_strbuf_puts(renderer->buffer, encoded);
+      cmark_strbuf_putc(renderer->buffer, '%');
+      cmark_strbuf_putc(renderer->buffer, "0123456789ABCDEF"[(c >> 4) & 0xF]);
+      cmark_strbuf_putc(renderer->buffer, "0123456789ABCDEF"[c & 0xF]);
       renderer->column += 3;
     } else if (cmark_ispunct((char)c)) {
       cmark_render_ascii(renderer, "\\");
       cmark_render_code_point(renderer, c);
     } else { // render as entity
-      snprintf(encoded, ENCODED_SIZE, "&#%d;", c);
-      cmark_strbuf_puts(renderer->buffer, encoded);
-      renderer->column += (int)strlen(encoded);
+      bufsize_t origsize = renderer->buffer->size;
+      cmark_strbuf_puts(renderer->buffer, "&#");
+      cmark_strbuf_put_int(renderer->buffer, c);
+      cmark_strbuf_putc(renderer->buffer, ';');
+      renderer->column += renderer->buffer->size - origsize;
     }
   } else {
     cmark_render_code_point(renderer, c);
@@ -244,10 +248,12 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
       // we ensure a width of at least 4 so
       // we get nice transition from single digits
       // to double
-      snprintf(listmarker, LISTMARKER_SIZE, "%d%s%s", list_number,
-               list_delim == CMARK_PAREN_DELIM ? ")" : ".",
-               list_number < 10 ? "  " : " ");
-      marker_width = (bufsize_t)strlen(listmarker);
+      marker_width = cmark_int_to_cstr(listmarker, list_number);
+      listmarker[marker_width++] = list_delim == CMARK_PAREN_DELIM ? ')' : '.';
+      listmarker[marker_width++] = ' ';
+      if (list_number < 10)
+        listmarker[marker_width++] = ' ';
+      listmarker[marker_width] = '\0';
     }
     if (entering) {
       if (cmark_node_get_list_type(node->parent) == CMARK_BULLET_LIST) {
@@ -302,7 +308,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
         !first_in_list_item) {
       LIT("    ");
       cmark_strbuf_puts(renderer->prefix, "    ");
-      OUT(cmark_node_get_literal(node), false, LITERAL);
+      OUT_LEN(code, code_len, false, LITERAL);
       cmark_strbuf_truncate(renderer->prefix, renderer->prefix->size - 4);
     } else {
       numticks = longest_backtick_sequence(code) + 1;
@@ -313,9 +319,9 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
         LIT(fencechar);
       }
       LIT(" ");
-      OUT(info, false, LITERAL);
+      OUT_LEN(info, info_len, false, LITERAL);
       CR();
-      OUT(cmark_node_get_literal(node), false, LITERAL);
+      OUT_LEN(code, code_len, false, LITERAL);
       CR();
       for (i = 0; i < numticks; i++) {
         LIT(fencechar);
@@ -326,7 +332,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
 
   case CMARK_NODE_HTML_BLOCK:
     BLANKLINE();
-    OUT(cmark_node_get_literal(node), false, LITERAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, false, LITERAL);
     BLANKLINE();
     break;
 
@@ -350,7 +356,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_TEXT:
-    OUT(cmark_node_get_literal(node), allow_wrap, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, NORMAL);
     break;
 
   case CMARK_NODE_LINEBREAK:
@@ -386,7 +392,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     if (extra_spaces) {
       LIT(" ");
     }
-    OUT(cmark_node_get_literal(node), allow_wrap, LITERAL);
+    OUT_LEN(code, code_len, allow_wrap, LITERAL);
     if (extra_spaces) {
       LIT(" ");
     }
@@ -396,7 +402,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_HTML_INLINE:
-    OUT(cmark_node_get_literal(node), false, LITERAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, false, LITERAL);
     break;
 
   case CMARK_NODE_CUSTOM_INLINE:
@@ -477,7 +483,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
   case CMARK_NODE_FOOTNOTE_REFERENCE:
     if (entering) {
       LIT("[^");
-      OUT(cmark_chunk_to_cstr(renderer->mem, &node->as.literal), false, LITERAL);
+      OUT_LEN(node->as.literal.data, node->as.literal.len, false, LITERAL);
       LIT("]");
     }
     break;
@@ -486,8 +492,8 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     if (entering) {
       renderer->footnote_ix += 1;
       LIT("[^");
-      char n[32];
-      snprintf(n, sizeof(n), "%d", renderer->footnote_ix);
+      char n[CMARK_INT_BUFSIZE];
+      cmark_int_to_cstr(n, (int)renderer->footnote_ix);
       OUT(n, false, LITERAL);
       LIT("]:\n");
 
@@ -517,3 +523,13 @@ char *cmark_render_commonmark_with_mem(cmark_node *root, int options, int width,
   }
   return cmark_render(mem, root, options, width, outc, S_render_node);
 }
+
+int cmark_render_commonmark_to_sink(cmark_node *root, int options, int width, cmark_sink *sink) {
+  if (options & CMARK_OPT_HARDBREAKS) {
+    // disable breaking on width, since it has
+    // a different meaning with OPT_HARDBREAKS
+    width = 0;
+  }
+  return cmark_render_to_sink(cmark_node_mem(root), root, options, width, outc,
+                              S_render_node, sink);
+}
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "houdini.h"
+#include "simd.h"
 
 /**
  * According to the OWASP rules:
@@ -29,33 +30,72 @@ static const char HTML_ESCAPE_TABLE[] = {
     0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-static const char *HTML_ESCAPES[] = {"",      "&quot;", "&amp;", "&#39;",
-                                     "&#47;", "&lt;",   "&gt;"};
+// The bytes that need escaping, split into nibble tables as done by
+// cmark_simd_byteset_init().  The forward slash and single quote are
+// only escaped in secure mode, which uses the second set.
+static const cmark_simd_byteset HTML_ESCAPE_SETS[] = {
+    {{
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     },
+     {0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 2, 0, 2, 0},
+     {0, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+     true},
+    {{
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 1,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+     },
+     {0, 0, 1, 0, 0, 0, 1, 1, 0, 0, 0, 0, 2, 0, 2, 1},
+     {0, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+     true},
+};
+
+typedef struct {
+  const char *str;
+  bufsize_t len;
+} html_escape;
+
+static const html_escape HTML_ESCAPES[] = {
+    {"", 0},      {"&quot;", 6}, {"&amp;", 5}, {"&#39;", 5},
+    {"&#47;", 5}, {"&lt;", 4},   {"&gt;", 4}};
 
 int houdini_escape_html0(cmark_strbuf *ob, const uint8_t *src, bufsize_t size,
                          int secure) {
-  bufsize_t i = 0, org, esc = 0;
+  const cmark_simd_byteset *set = &HTML_ESCAPE_SETS[secure ? 1 : 0];
+  const uint8_t *p = src, *end = src + size, *org;
+  const html_escape *esc;
 
-  while (i < size) {
-    org = i;
-    while (i < size && (esc = HTML_ESCAPE_TABLE[src[i]]) == 0)
-      i++;
+  while (p < end) {
+    org = p;
+    p = cmark_simd_find_set(p, end, set);
 
-    if (i > org)
-      cmark_strbuf_put(ob, src + org, i - org);
+    if (p > org)
+      cmark_strbuf_put(ob, org, (bufsize_t)(p - org));
 
-    /* escaping */
-    if (unlikely(i >= size))
+    if (p == end)
       break;
 
-    /* The forward slash and single quote are only escaped in secure mode */
-    if ((src[i] == '/' || src[i] == '\'') && !secure) {
-      cmark_strbuf_putc(ob, src[i]);
-    } else {
-      cmark_strbuf_puts(ob, HTML_ESCAPES[esc]);
-    }
-
-    i++;
+    esc = &HTML_ESCAPES[(int)HTML_ESCAPE_TABLE[*p]];
+    cmark_strbuf_put(ob, (const unsigned char *)esc->str, esc->len);
+    p++;
   }
 
   return 1;
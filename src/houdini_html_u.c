@@ -7,32 +7,28 @@
 #include "utf8.h"
 #include "entities.inc"
 
-/* Binary tree lookup code for entities added by JGM */
-
-static const unsigned char *S_lookup(int i, int low, int hi,
-                                     const unsigned char *s, int len) {
-  int j;
-  int cmp =
-      strncmp((const char *)s, (const char *)cmark_entities[i].entity, len);
-  if (cmp == 0 && cmark_entities[i].entity[len] == 0) {
-    return (const unsigned char *)cmark_entities[i].bytes;
-  } else if (cmp <= 0 && i > low) {
-    j = i - ((i - low) / 2);
-    if (j == i)
-      j -= 1;
-    return S_lookup(j, low, i - 1, s, len);
-  } else if (cmp > 0 && i < hi) {
-    j = i + ((hi - i) / 2);
-    if (j == i)
-      j += 1;
-    return S_lookup(j, i + 1, hi, s, len);
-  } else {
-    return NULL;
-  }
+/* Perfect hash lookup, see tools/make_entities_inc.py */
+
+static CMARK_INLINE uint32_t S_entity_hash(uint32_t seed,
+                                           const unsigned char *s, int len) {
+  uint32_t h = 2166136261u ^ seed;
+  int i;
+
+  for (i = 0; i < len; ++i)
+    h = (h ^ s[i]) * 16777619u;
+  return h;
 }
 
 static const unsigned char *S_lookup_entity(const unsigned char *s, int len) {
-  return S_lookup(CMARK_NUM_ENTITIES / 2, 0, CMARK_NUM_ENTITIES - 1, s, len);
+  uint32_t seed = cmark_entity_seeds[S_entity_hash(0, s, len) %
+                                     CMARK_ENTITY_BUCKETS];
+  const struct cmark_entity_node *node =
+      &cmark_entities[S_entity_hash(seed, s, len) % CMARK_NUM_ENTITIES];
+
+  if (strncmp((const char *)s, (const char *)node->entity, len) == 0 &&
+      node->entity[len] == 0)
+    return (const unsigned char *)node->bytes;
+  return NULL;
 }
 
 bufsize_t houdini_unescape_ent(cmark_strbuf *ob, const uint8_t *src,
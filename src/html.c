@@ -9,6 +9,7 @@
 #include "scanners.h"
 #include "syntax_extension.h"
 #include "html.h"
+#include "references.h"
 #include "render.h"
 
 // Functions to convert cmark_nodes to HTML strings.
@@ -65,9 +66,7 @@ static bool S_put_footnote_backref(cmark_html_renderer *renderer, cmark_strbuf *
   renderer->written_footnote_ix = renderer->footnote_ix;
 
   cmark_strbuf_puts(html, "<a href=\"#fnref");
-  char n[32];
-  snprintf(n, sizeof(n), "%d", renderer->footnote_ix);
-  cmark_strbuf_puts(html, n);
+  cmark_strbuf_put_int(html, (int)renderer->footnote_ix);
   cmark_strbuf_puts(html, "\" class=\"footnote-backref\">↩</a>");
 
   return true;
@@ -84,7 +83,6 @@ static int S_render_node(cmark_html_renderer *renderer, cmark_node *node,
   char end_heading[] = "</h0";
   bool tight;
   bool filtered;
-  char buffer[BUFFER_SIZE];
 
   bool entering = (ev_type == CMARK_EVENT_ENTER);
 
@@ -147,8 +145,9 @@ static int S_render_node(cmark_html_renderer *renderer, cmark_node *node,
         cmark_html_render_sourcepos(node, html, options);
         cmark_strbuf_puts(html, ">\n");
       } else {
-        snprintf(buffer, BUFFER_SIZE, "<ol start=\"%d\"", start);
-        cmark_strbuf_puts(html, buffer);
+        cmark_strbuf_puts(html, "<ol start=\"");
+        cmark_strbuf_put_int(html, start);
+        cmark_strbuf_putc(html, '"');
         cmark_html_render_sourcepos(node, html, options);
         cmark_strbuf_puts(html, ">\n");
       }
@@ -396,9 +395,7 @@ static int S_render_node(cmark_html_renderer *renderer, cmark_node *node,
       }
       ++renderer->footnote_ix;
       cmark_strbuf_puts(html, "<li id=\"fn");
-      char n[32];
-      snprintf(n, sizeof(n), "%d", renderer->footnote_ix);
-      cmark_strbuf_puts(html, n);
+      cmark_strbuf_put_int(html, (int)renderer->footnote_ix);
       cmark_strbuf_puts(html, "\">\n");
     } else {
       if (S_put_footnote_backref(renderer, html)) {
@@ -432,12 +429,15 @@ char *cmark_render_html(cmark_node *root, int options, cmark_llist *extensions)
   return cmark_render_html_with_mem(root, options, extensions, cmark_node_mem(root));
 }
 
-char *cmark_render_html_with_mem(cmark_node *root, int options, cmark_llist *extensions, cmark_mem *mem) {
-  char *result;
-  cmark_strbuf html = CMARK_BUF_INIT(mem);
+// Render 'root' into 'html'.  With a 'sink', output is passed on as it
+// accumulates, keeping the last byte for 'cmark_html_render_cr', and
+// rendering stops once a write has failed.
+static void S_render_html(cmark_strbuf *html, cmark_node *root, int options,
+                          cmark_llist *extensions, cmark_mem *mem,
+                          cmark_sink *sink, int *status) {
   cmark_event_type ev_type;
   cmark_node *cur;
-  cmark_html_renderer renderer = {&html, NULL, NULL, 0, 0, NULL};
+  cmark_html_renderer renderer = {html, NULL, NULL, 0, 0, NULL};
   cmark_iter *iter = cmark_iter_new(root);
 
   for (; extensions; extensions = extensions->next)
@@ -447,19 +447,166 @@ char *cmark_render_html_with_mem(cmark_node *root, int options, cmark_llist *ext
           renderer.filter_extensions,
           (cmark_syntax_extension *) extensions->data);
 
-  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+  while ((!sink || !*status) &&
+         (ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
     cur = cmark_iter_get_node(iter);
     S_render_node(&renderer, cur, ev_type, options);
+    if (sink && cmark_sink_ready(sink, html))
+      cmark_sink_drain(sink, html, html->size - 1, status);
   }
 
   if (renderer.footnote_ix) {
-    cmark_strbuf_puts(&html, "</ol>\n</section>\n");
+    cmark_strbuf_puts(html, "</ol>\n</section>\n");
   }
 
-  result = (char *)cmark_strbuf_detach(&html);
-
   cmark_llist_free(mem, renderer.filter_extensions);
 
   cmark_iter_free(iter);
-  return result;
+}
+
+char *cmark_render_html_with_mem(cmark_node *root, int options, cmark_llist *extensions, cmark_mem *mem) {
+  cmark_strbuf html = CMARK_BUF_INIT(mem);
+
+  S_render_html(&html, root, options, extensions, mem, NULL, NULL);
+  return (char *)cmark_strbuf_detach(&html);
+}
+
+void cmark_render_html_append(cmark_strbuf *html, cmark_node *root, int options, cmark_llist *extensions) {
+  S_render_html(html, root, options, extensions, html->mem, NULL, NULL);
+}
+
+typedef struct {
+  char *ptr;
+  size_t capacity;
+  size_t size;
+} html_buffer;
+
+static int S_write_buffer(const char *data, size_t len, void *userdata) {
+  html_buffer *buf = (html_buffer *)userdata;
+
+  if (buf->size < buf->capacity)
+    memcpy(buf->ptr + buf->size, data,
+           len < buf->capacity - buf->size ? len : buf->capacity - buf->size);
+  buf->size += len;
+  return 0;
+}
+
+size_t cmark_render_html_to_buffer(cmark_node *root, int options, cmark_llist *extensions, char *buffer, size_t capacity) {
+  html_buffer buf = {buffer, capacity ? capacity - 1 : 0, 0};
+  cmark_sink sink = {S_write_buffer, &buf, 0};
+
+  cmark_render_html_to_sink(root, options, extensions, &sink);
+  if (capacity)
+    buffer[buf.size < buf.capacity ? buf.size : buf.capacity] = '\0';
+  return buf.size;
+}
+
+size_t cmark_render_html_estimate(cmark_node *root, int options) {
+  cmark_event_type ev_type;
+  cmark_node *cur;
+  size_t size = 0;
+  cmark_iter *iter = cmark_iter_new(root);
+
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    if (ev_type != CMARK_EVENT_ENTER)
+      continue;
+    cur = cmark_iter_get_node(iter);
+
+    // The text of a node, plus about what it takes to open and close it.
+    switch (cur->type) {
+    case CMARK_NODE_TEXT:
+    case CMARK_NODE_HTML_INLINE:
+    case CMARK_NODE_HTML_BLOCK:
+      size += cur->as.literal.len;
+      break;
+    case CMARK_NODE_CODE:
+      size += cur->as.literal.len + 13;
+      break;
+    case CMARK_NODE_CODE_BLOCK:
+      size += cur->as.code.literal.len + cur->as.code.info.len + 40;
+      break;
+    case CMARK_NODE_LINK:
+    case CMARK_NODE_IMAGE:
+      size += cur->as.link.url.len + cur->as.link.title.len + 32;
+      break;
+    case CMARK_NODE_SOFTBREAK:
+    case CMARK_NODE_LINEBREAK:
+      size += 7;
+      break;
+    default:
+      size += 16;
+      break;
+    }
+
+    if ((options & CMARK_OPT_SOURCEPOS) && CMARK_NODE_BLOCK_P(cur))
+      size += 32;
+  }
+
+  cmark_iter_free(iter);
+
+  // Leave some room for escaping.
+  return size + size / 8;
+}
+
+int cmark_render_html_to_sink(cmark_node *root, int options, cmark_llist *extensions, cmark_sink *sink) {
+  cmark_mem *mem = cmark_node_mem(root);
+  cmark_strbuf html = CMARK_BUF_INIT(mem);
+  int status = 0;
+
+  S_render_html(&html, root, options, extensions, mem, sink, &status);
+  cmark_sink_drain(sink, &html, html.size, &status);
+  cmark_strbuf_free(&html);
+  return status;
+}
+
+typedef struct {
+  cmark_strbuf html;
+  cmark_sink sink;
+  int options;
+  int status;
+} html_stream;
+
+static void S_render_streamed_block(cmark_node *document, void *data) {
+  html_stream *stream = (html_stream *)data;
+
+  if (!stream->status)
+    S_render_html(&stream->html, document, stream->options, NULL,
+                  stream->html.mem, &stream->sink, &stream->status);
+  cmark_node_free(document);
+}
+
+int cmark_markdown_to_html_stream(const char *text, size_t len, int options,
+                                  cmark_write_func write, void *userdata) {
+  cmark_mem *mem = cmark_get_default_mem_allocator();
+  cmark_parser *parser = cmark_parser_new_with_mem(options, mem);
+  html_stream stream = {CMARK_BUF_INIT(mem), {write, userdata, 0}, options, 0};
+  cmark_node *doc;
+
+  if (options & CMARK_OPT_FOOTNOTES) {
+    // Footnotes are numbered and moved to the end across the document.
+    cmark_parser_feed(parser, text, len);
+    doc = cmark_parser_finish(parser);
+    S_render_html(&stream.html, doc, options, NULL, mem, &stream.sink,
+                  &stream.status);
+    cmark_node_free(doc);
+  } else {
+    // Links may come before their definitions.  Unless there cannot be
+    // any, collect them all in a first pass, which keeps no blocks.
+    if (cmark_may_define_labels((const unsigned char *)text, len)) {
+      cmark_parser_set_block_callback(parser, NULL, NULL,
+                                      CMARK_STREAM_COLLECT_DEFINITIONS);
+      cmark_parser_feed(parser, text, len);
+      cmark_node_free(cmark_parser_finish(parser));
+    }
+    cmark_parser_set_block_callback(parser, S_render_streamed_block, &stream,
+                                    CMARK_STREAM_DEFINED_SO_FAR);
+    cmark_parser_feed(parser, text, len);
+    cmark_node_free(cmark_parser_finish(parser));
+  }
+
+  cmark_sink_drain(&stream.sink, &stream.html, stream.html.size, &stream.status);
+  cmark_strbuf_free(&stream.html);
+  cmark_parser_free(parser);
+
+  return stream.status;
 }
@@ -10,16 +10,23 @@ static void cmark_html_render_cr(cmark_strbuf *html) {
     cmark_strbuf_putc(html, '\n');
 }
 
-#define BUFFER_SIZE 100
+/** As for 'cmark_render_html', but appending the output to 'html'.
+ */
+CMARK_GFM_EXPORT
+void cmark_render_html_append(cmark_strbuf *html, cmark_node *root, int options, cmark_llist *extensions);
 
 CMARK_INLINE 
 static void cmark_html_render_sourcepos(cmark_node *node, cmark_strbuf *html, int options) {
-  char buffer[BUFFER_SIZE];
   if (CMARK_OPT_SOURCEPOS & options) {
-    snprintf(buffer, BUFFER_SIZE, " data-sourcepos=\"%d:%d-%d:%d\"",
-             cmark_node_get_start_line(node), cmark_node_get_start_column(node),
-             cmark_node_get_end_line(node), cmark_node_get_end_column(node));
-    cmark_strbuf_puts(html, buffer);
+    cmark_strbuf_puts(html, " data-sourcepos=\"");
+    cmark_strbuf_put_int(html, cmark_node_get_start_line(node));
+    cmark_strbuf_putc(html, ':');
+    cmark_strbuf_put_int(html, cmark_node_get_start_column(node));
+    cmark_strbuf_putc(html, '-');
+    cmark_strbuf_put_int(html, cmark_node_get_end_line(node));
+    cmark_strbuf_putc(html, ':');
+    cmark_strbuf_put_int(html, cmark_node_get_end_column(node));
+    cmark_strbuf_putc(html, '"');
   }
 }
 
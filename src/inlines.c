@@ -13,6 +13,7 @@
 #include "scanners.h"
 #include "inlines.h"
 #include "syntax_extension.h"
+#include "simd.h"
 
 static const char *EMDASH = "\xE2\x80\x94";
 static const char *ENDASH = "\xE2\x80\x93";
@@ -26,10 +27,10 @@ static const char *RIGHTSINGLEQUOTE = "\xE2\x80\x99";
 #define make_str(subj, sc, ec, s) make_literal(subj, CMARK_NODE_TEXT, sc, ec, s)
 #define make_code(subj, sc, ec, s) make_literal(subj, CMARK_NODE_CODE, sc, ec, s)
 #define make_raw_html(subj, sc, ec, s) make_literal(subj, CMARK_NODE_HTML_INLINE, sc, ec, s)
-#define make_linebreak(mem) make_simple(mem, CMARK_NODE_LINEBREAK)
-#define make_softbreak(mem) make_simple(mem, CMARK_NODE_SOFTBREAK)
-#define make_emph(mem) make_simple(mem, CMARK_NODE_EMPH)
-#define make_strong(mem) make_simple(mem, CMARK_NODE_STRONG)
+#define make_linebreak(subj) make_simple(subj, CMARK_NODE_LINEBREAK)
+#define make_softbreak(subj) make_simple(subj, CMARK_NODE_SOFTBREAK)
+#define make_emph(subj) make_simple(subj, CMARK_NODE_EMPH)
+#define make_strong(subj) make_simple(subj, CMARK_NODE_STRONG)
 
 #define MAXBACKTICKS 80
 
@@ -45,6 +46,8 @@ typedef struct bracket {
 
 typedef struct subject{
   cmark_mem *mem;
+  // where new nodes are allocated; NULL if the subject makes none
+  cmark_node_pool *pool;
   cmark_chunk input;
   int line;
   bufsize_t pos;
@@ -55,10 +58,13 @@ typedef struct subject{
   bracket *last_bracket;
   bufsize_t backticks[MAXBACKTICKS + 1];
   bool scanned_for_backticks;
+  const int8_t *skip_chars;
+  // set when a link label was looked up and not found
+  bool missed_label;
 } subject;
 
-// Extensions may populate this.
-static int8_t SKIP_CHARS[256];
+// Used by subjects that are not parsing a block's inlines.
+static const int8_t NO_SKIP_CHARS[256];
 
 static CMARK_INLINE bool S_is_line_end_char(char c) {
   return (c == '\n' || c == '\r');
@@ -69,17 +75,17 @@ static delimiter *S_insert_emph(subject *subj, delimiter *opener,
 
 static int parse_inline(cmark_parser *parser, subject *subj, cmark_node *parent, int options);
 
-static void subject_from_buf(cmark_mem *mem, int line_number, int block_offset, subject *e,
+static void subject_from_buf(cmark_mem *mem, cmark_node_pool *pool,
+                             int line_number, int block_offset, subject *e,
                              cmark_chunk *buffer, cmark_map *refmap);
-static bufsize_t subject_find_special_char(subject *subj, int options);
+static bufsize_t subject_find_special_char(cmark_parser *parser, subject *subj,
+                                           int options);
 
 // Create an inline with a literal string value.
 static CMARK_INLINE cmark_node *make_literal(subject *subj, cmark_node_type t,
                                              int start_column, int end_column,
                                              cmark_chunk s) {
-  cmark_node *e = (cmark_node *)subj->mem->calloc(1, sizeof(*e));
-  cmark_strbuf_init(subj->mem, &e->content, 0);
-  e->type = (uint16_t)t;
+  cmark_node *e = cmark_node_new_inline(subj->pool, t);
   e->as.literal = s;
   e->start_line = e->end_line = subj->line;
   // columns are 1 based.
@@ -89,11 +95,8 @@ static CMARK_INLINE cmark_node *make_literal(subject *subj, cmark_node_type t,
 }
 
 // Create an inline with no value.
-static CMARK_INLINE cmark_node *make_simple(cmark_mem *mem, cmark_node_type t) {
-  cmark_node *e = (cmark_node *)mem->calloc(1, sizeof(*e));
-  cmark_strbuf_init(mem, &e->content, 0);
-  e->type = (uint16_t)t;
-  return e;
+static CMARK_INLINE cmark_node *make_simple(subject *subj, cmark_node_type t) {
+  return cmark_node_new_inline(subj->pool, t);
 }
 
 // Like make_str, but parses entities.
@@ -146,7 +149,7 @@ static cmark_chunk cmark_clean_autolink(cmark_mem *mem, cmark_chunk *url,
 static CMARK_INLINE cmark_node *make_autolink(subject *subj,
                                               int start_column, int end_column,
                                               cmark_chunk url, int is_email) {
-  cmark_node *link = make_simple(subj->mem, CMARK_NODE_LINK);
+  cmark_node *link = make_simple(subj, CMARK_NODE_LINK);
   link->as.link.url = cmark_clean_autolink(subj->mem, &url, is_email);
   link->as.link.title = cmark_chunk_literal("");
   link->start_line = link->end_line = subj->line;
@@ -156,10 +159,12 @@ static CMARK_INLINE cmark_node *make_autolink(subject *subj,
   return link;
 }
 
-static void subject_from_buf(cmark_mem *mem, int line_number, int block_offset, subject *e,
+static void subject_from_buf(cmark_mem *mem, cmark_node_pool *pool,
+                             int line_number, int block_offset, subject *e,
                              cmark_chunk *chunk, cmark_map *refmap) {
   int i;
   e->mem = mem;
+  e->pool = pool;
   e->input = *chunk;
   e->line = line_number;
   e->pos = 0;
@@ -172,6 +177,8 @@ static void subject_from_buf(cmark_mem *mem, int line_number, int block_offset,
     e->backticks[i] = 0;
   }
   e->scanned_for_backticks = false;
+  e->skip_chars = NO_SKIP_CHARS;
+  e->missed_label = false;
 }
 
 static CMARK_INLINE int isbacktick(int c) { return (c == '`'); }
@@ -398,12 +405,12 @@ static int scan_delims(subject *subj, unsigned char c, bool *can_open,
   } else {
     before_char_pos = subj->pos - 1;
     // walk back to the beginning of the UTF_8 sequence:
-    while ((peek_at(subj, before_char_pos) >> 6 == 2 || SKIP_CHARS[peek_at(subj, before_char_pos)]) && before_char_pos > 0) {
+    while ((peek_at(subj, before_char_pos) >> 6 == 2 || subj->skip_chars[peek_at(subj, before_char_pos)]) && before_char_pos > 0) {
       before_char_pos -= 1;
     }
     len = cmark_utf8proc_iterate(subj->input.data + before_char_pos,
                                  subj->pos - before_char_pos, &before_char);
-    if (len == -1 || (before_char < 256 && SKIP_CHARS[(unsigned char) before_char])) {
+    if (len == -1 || (before_char < 256 && subj->skip_chars[(unsigned char) before_char])) {
       before_char = 10;
     }
   }
@@ -422,12 +429,12 @@ static int scan_delims(subject *subj, unsigned char c, bool *can_open,
     after_char = 10;
   } else {
     after_char_pos = subj->pos;
-    while (SKIP_CHARS[peek_at(subj, after_char_pos)] && after_char_pos < subj->input.len) {
+    while (subj->skip_chars[peek_at(subj, after_char_pos)] && after_char_pos < subj->input.len) {
       after_char_pos += 1;
     }
     len = cmark_utf8proc_iterate(subj->input.data + after_char_pos,
                                  subj->input.len - after_char_pos, &after_char);
-    if (len == -1 || (after_char < 256 && SKIP_CHARS[(unsigned char) after_char])) {
+    if (len == -1 || (after_char < 256 && subj->skip_chars[(unsigned char) after_char])) {
     after_char = 10;
   }
   }
@@ -754,7 +761,7 @@ static delimiter *S_insert_emph(subject *subj, delimiter *opener,
 
   // create new emph or strong, and splice it in to our inlines
   // between the opener and closer
-  emph = use_delims == 1 ? make_emph(subj->mem) : make_strong(subj->mem);
+  emph = use_delims == 1 ? make_emph(subj) : make_strong(subj);
 
   tmp = opener_inl->next;
   while (tmp && tmp != closer_inl) {
@@ -797,7 +804,7 @@ static cmark_node *handle_backslash(cmark_parser *parser, subject *subj) {
     advance(subj);
     return make_str(subj, subj->pos - 2, subj->pos - 1, cmark_chunk_dup(&subj->input, subj->pos - 1, 1));
   } else if (!is_eof(subj) && skip_line_end(subj)) {
-    return make_linebreak(subj->mem);
+    return make_linebreak(subj);
   } else {
     return make_str(subj, subj->pos - 1, subj->pos - 1, cmark_chunk_literal("\\"));
   }
@@ -1122,6 +1129,8 @@ static cmark_node *handle_close_bracket(cmark_parser *parser, subject *subj) {
   if (found_label) {
     ref = (cmark_reference *)cmark_map_lookup(subj->refmap, &raw_label);
     cmark_chunk_free(subj->mem, &raw_label);
+    if (ref == NULL)
+      subj->missed_label = true;
   }
 
   if (ref != NULL) { // found
@@ -1141,7 +1150,7 @@ noMatch:
       !opener->inl_text->next->next) {
     cmark_chunk *literal = &opener->inl_text->next->as.literal;
     if (literal->len > 1 && literal->data[0] == '^') {
-      inl = make_simple(subj->mem, CMARK_NODE_FOOTNOTE_REFERENCE);
+      inl = make_simple(subj, CMARK_NODE_FOOTNOTE_REFERENCE);
       inl->as.literal = cmark_chunk_dup(literal, 1, literal->len - 1);
       inl->start_line = inl->end_line = subj->line;
       inl->start_column = opener->inl_text->start_column;
@@ -1160,7 +1169,7 @@ noMatch:
   return make_str(subj, subj->pos - 1, subj->pos - 1, cmark_chunk_literal("]"));
 
 match:
-  inl = make_simple(subj->mem, is_image ? CMARK_NODE_IMAGE : CMARK_NODE_LINK);
+  inl = make_simple(subj, is_image ? CMARK_NODE_IMAGE : CMARK_NODE_LINK);
   inl->as.link.url = url;
   inl->as.link.title = title;
   inl->start_line = inl->end_line = subj->line;
@@ -1218,14 +1227,14 @@ static cmark_node *handle_newline(subject *subj) {
   skip_spaces(subj);
   if (nlpos > 1 && peek_at(subj, nlpos - 1) == ' ' &&
       peek_at(subj, nlpos - 2) == ' ') {
-    return make_linebreak(subj->mem);
+    return make_linebreak(subj);
   } else {
-    return make_softbreak(subj->mem);
+    return make_softbreak(subj);
   }
 }
 
 // "\r\n\\`&_*[]<!"
-static int8_t SPECIAL_CHARS[256] = {
+static const int8_t SPECIAL_CHARS[256] = {
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
       0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0,
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -1239,7 +1248,7 @@ static int8_t SPECIAL_CHARS[256] = {
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 // " ' . -
-static char SMART_PUNCT_CHARS[] = {
+static const int8_t SMART_PUNCT_CHARS[256] = {
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1, 1, 0,
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -1253,30 +1262,53 @@ static char SMART_PUNCT_CHARS[] = {
       0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 };
 
-static bufsize_t subject_find_special_char(subject *subj, int options) {
+static bufsize_t subject_find_special_char(cmark_parser *parser, subject *subj,
+                                           int options) {
   bufsize_t n = subj->pos + 1;
+  const unsigned char *data = subj->input.data;
+  const cmark_simd_byteset *set = (options & CMARK_OPT_SMART)
+                                      ? &parser->special_chars->smart
+                                      : &parser->special_chars->special;
 
-  while (n < subj->input.len) {
-    if (SPECIAL_CHARS[subj->input.data[n]])
-      return n;
-    if (options & CMARK_OPT_SMART && SMART_PUNCT_CHARS[subj->input.data[n]])
-      return n;
-    n++;
-  }
+  if (n >= subj->input.len)
+    return subj->input.len;
 
-  return subj->input.len;
+  return (bufsize_t)(cmark_simd_find_set(data + n, data + subj->input.len,
+                                         set) - data);
 }
 
-void cmark_inlines_add_special_character(unsigned char c, bool emphasis) {
-  SPECIAL_CHARS[c] = 1;
-  if (emphasis)
-    SKIP_CHARS[c] = 1;
-}
+// (Re)builds the parser's special character tables, including the
+// characters of its inline syntax extensions if 'extensions' is true.
+void cmark_inlines_update_special_chars(cmark_parser *parser, bool extensions) {
+  struct cmark_special_chars *chars = parser->special_chars;
+  int8_t special[256], smart[256];
+  cmark_llist *tmp_ext, *tmp_char;
+  int i;
 
-void cmark_inlines_remove_special_character(unsigned char c, bool emphasis) {
-  SPECIAL_CHARS[c] = 0;
-  if (emphasis)
-    SKIP_CHARS[c] = 0;
+  if (!chars) {
+    chars = (struct cmark_special_chars *)parser->mem->calloc(1, sizeof(*chars));
+    parser->special_chars = chars;
+  }
+
+  memcpy(special, SPECIAL_CHARS, sizeof(special));
+  memset(chars->skip, 0, sizeof(chars->skip));
+
+  for (tmp_ext = extensions ? parser->inline_syntax_extensions : NULL; tmp_ext;
+       tmp_ext = tmp_ext->next) {
+    cmark_syntax_extension *ext = (cmark_syntax_extension *) tmp_ext->data;
+    for (tmp_char = ext->special_inline_chars; tmp_char; tmp_char = tmp_char->next) {
+      unsigned char c = (unsigned char)(size_t)tmp_char->data;
+      special[c] = 1;
+      if (ext->emphasis)
+        chars->skip[c] = 1;
+    }
+  }
+
+  for (i = 0; i < 256; ++i)
+    smart[i] = special[i] || SMART_PUNCT_CHARS[i];
+
+  cmark_simd_byteset_init(&chars->special, special);
+  cmark_simd_byteset_init(&chars->smart, smart);
 }
 
 static cmark_node *try_extensions(cmark_parser *parser,
@@ -1360,7 +1392,7 @@ static int parse_inline(cmark_parser *parser, subject *subj, cmark_node *parent,
     if (new_inl != NULL)
       break;
 
-    endpos = subject_find_special_char(subj, options);
+    endpos = subject_find_special_char(parser, subj, options);
     contents = cmark_chunk_dup(&subj->input, subj->pos, endpos - subj->pos);
     startpos = subj->pos;
     subj->pos = endpos;
@@ -1384,10 +1416,19 @@ void cmark_parse_inlines(cmark_parser *parser,
                          cmark_node *parent,
                          cmark_map *refmap,
                          int options) {
+  cmark_parse_inlines_with_pool(parser, parser->pool, parent, refmap, options);
+}
+
+void cmark_parse_inlines_with_pool(cmark_parser *parser,
+                                   cmark_node_pool *pool,
+                                   cmark_node *parent,
+                                   cmark_map *refmap,
+                                   int options) {
   subject subj;
   cmark_chunk content = {parent->content.ptr, parent->content.size, 0};
-  subject_from_buf(parser->mem, parent->start_line, parent->start_column - 1 + parent->internal_offset, &subj, &content, refmap);
+  subject_from_buf(parser->mem, pool, parent->start_line, parent->start_column - 1 + parent->internal_offset, &subj, &content, refmap);
   cmark_chunk_rtrim(&subj.input);
+  subj.skip_chars = parser->special_chars->skip;
 
   while (!is_eof(&subj) && parse_inline(parser, &subj, parent, options))
     ;
@@ -1400,6 +1441,9 @@ void cmark_parse_inlines(cmark_parser *parser,
   while (subj.last_bracket) {
     pop_bracket(&subj);
   }
+
+  if (subj.missed_label)
+    parent->flags |= CMARK_NODE__MISSED_LABEL;
 }
 
 // Parse zero or more space characters, including at most one newline.
@@ -1425,7 +1469,7 @@ bufsize_t cmark_parse_reference_inline(cmark_mem *mem, cmark_chunk *input,
   bufsize_t matchlen = 0;
   bufsize_t beforetitle;
 
-  subject_from_buf(mem, -1, 0, &subj, input, NULL);
+  subject_from_buf(mem, NULL, -1, 0, &subj, input, NULL);
 
   // parse label:
   if (!link_label(&subj, &lab) || lab.len == 0)
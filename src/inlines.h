@@ -6,6 +6,18 @@ extern "C" {
 #endif
 
 #include "references.h"
+#include "simd.h"
+
+// The bytes that interrupt a run of text for one parser: the core
+// special characters plus those of its inline syntax extensions.
+struct cmark_special_chars {
+  cmark_simd_byteset special;
+  // 'special' plus the smart punctuation characters, for CMARK_OPT_SMART
+  cmark_simd_byteset smart;
+  // emphasis-like extension characters, skipped over when scanning the
+  // characters on either side of a delimiter run
+  int8_t skip[256];
+};
 
 cmark_chunk cmark_clean_url(cmark_mem *mem, cmark_chunk *url);
 cmark_chunk cmark_clean_title(cmark_mem *mem, cmark_chunk *title);
@@ -16,11 +28,18 @@ void cmark_parse_inlines(cmark_parser *parser,
                          cmark_map *refmap,
                          int options);
 
+// Like cmark_parse_inlines(), allocating the new nodes from 'pool' rather
+// than the parser's own, so that several threads can parse inlines.
+void cmark_parse_inlines_with_pool(cmark_parser *parser,
+                                   cmark_node_pool *pool,
+                                   cmark_node *parent,
+                                   cmark_map *refmap,
+                                   int options);
+
 bufsize_t cmark_parse_reference_inline(cmark_mem *mem, cmark_chunk *input,
                                        cmark_map *refmap);
 
-void cmark_inlines_add_special_character(unsigned char c, bool emphasis);
-void cmark_inlines_remove_special_character(unsigned char c, bool emphasis);
+void cmark_inlines_update_special_chars(cmark_parser *parser, bool extensions);
 
 #ifdef __cplusplus
 }
@@ -10,7 +10,7 @@ cmark_iter *cmark_iter_new(cmark_node *root) {
   if (root == NULL) {
     return NULL;
   }
-  cmark_mem *mem = root->content.mem;
+  cmark_mem *mem = cmark_node_mem(root);
   cmark_iter *iter = (cmark_iter *)mem->calloc(1, sizeof(cmark_iter));
   iter->mem = mem;
   iter->root = root;
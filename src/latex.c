@@ -12,8 +12,11 @@
 #include "render.h"
 #include "syntax_extension.h"
 
-#define OUT(s, wrap, escaping) renderer->out(renderer, node, s, wrap, escaping)
-#define LIT(s) renderer->out(renderer, node, s, false, LITERAL)
+#define OUT(s, wrap, escaping) cmark_render_out(renderer, node, s, wrap, escaping)
+#define OUT_LEN(s, len, wrap, escaping)                                        \
+  renderer->out_len(renderer, node, (const char *)(s), (bufsize_t)(len), wrap, \
+                    escaping)
+#define LIT(s) cmark_render_out(renderer, node, s, false, LITERAL)
 #define CR() renderer->cr(renderer)
 #define BLANKLINE() renderer->blankline(renderer)
 #define LIST_NUMBER_STRING_SIZE 20
@@ -259,8 +262,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
         enumlevel = S_get_enumlevel(node);
         // latex normally supports only five levels
         if (enumlevel >= 1 && enumlevel <= 5) {
-          snprintf(list_number_string, LIST_NUMBER_STRING_SIZE, "%d",
-                   list_number);
+          cmark_int_to_cstr(list_number_string, list_number);
           LIT("\\setcounter{enum");
           switch (enumlevel) {
           case 1: LIT("i"); break;
@@ -322,7 +324,8 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     CR();
     LIT("\\begin{verbatim}");
     CR();
-    OUT(cmark_node_get_literal(node), false, LITERAL);
+    OUT_LEN(node->as.code.literal.data, node->as.code.literal.len, false,
+            LITERAL);
     CR();
     LIT("\\end{verbatim}");
     BLANKLINE();
@@ -351,7 +354,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_TEXT:
-    OUT(cmark_node_get_literal(node), allow_wrap, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, NORMAL);
     break;
 
   case CMARK_NODE_LINEBREAK:
@@ -372,7 +375,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
 
   case CMARK_NODE_CODE:
     LIT("\\texttt{");
-    OUT(cmark_node_get_literal(node), false, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, false, NORMAL);
     LIT("}");
     break;
 
@@ -464,3 +467,8 @@ char *cmark_render_latex(cmark_node *root, int options, int width) {
 char *cmark_render_latex_with_mem(cmark_node *root, int options, int width, cmark_mem *mem) {
   return cmark_render(mem, root, options, width, outc, S_render_node);
 }
+
+int cmark_render_latex_to_sink(cmark_node *root, int options, int width, cmark_sink *sink) {
+  return cmark_render_to_sink(cmark_node_mem(root), root, options, width, outc,
+                              S_render_node, sink);
+}
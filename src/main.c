@@ -64,43 +64,67 @@ void print_usage() {
          "                                  instead of align attributes.\n");
   printf("  --full-info-string              Include remainder of code block info\n"
          "                                  string in a separate attribute.\n");
+  printf("  --threads N                     Parse on up to N threads\n");
   printf("  --help, -h       Print usage information\n");
   printf("  --version        Print version\n");
 }
 
+typedef struct {
+  char *data;
+  size_t size, alloc;
+} input_buffer;
+
+// With several threads, collect the whole input so that it can be split
+// up; otherwise parse it as it arrives.
+static void feed_input(cmark_parser *parser, input_buffer *input,
+                       const char *buffer, size_t bytes) {
+  if (parser->threads < 2) {
+    cmark_parser_feed(parser, buffer, bytes);
+    return;
+  }
+
+  if (input->size + bytes > input->alloc) {
+    input->alloc = (input->size + bytes) * 2;
+    input->data = (char *)realloc(input->data, input->alloc);
+    if (!input->data) {
+      fprintf(stderr, "[cmark] realloc returned null pointer, aborting\n");
+      abort();
+    }
+  }
+  memcpy(input->data + input->size, buffer, bytes);
+  input->size += bytes;
+}
+
 static bool print_document(cmark_node *document, writer_format writer,
                            int options, int width, cmark_parser *parser) {
-  char *result;
-
-  cmark_mem *mem = cmark_get_default_mem_allocator();
+  cmark_sink sink = {cmark_write_file, stdout, 0};
+  int status;
 
   switch (writer) {
   case FORMAT_HTML:
-    result = cmark_render_html_with_mem(document, options, parser->syntax_extensions, mem);
+    status = cmark_render_html_to_sink(document, options, parser->syntax_extensions, &sink);
     break;
   case FORMAT_XML:
-    result = cmark_render_xml_with_mem(document, options, mem);
+    status = cmark_render_xml_to_sink(document, options, &sink);
     break;
   case FORMAT_MAN:
-    result = cmark_render_man_with_mem(document, options, width, mem);
+    status = cmark_render_man_to_sink(document, options, width, &sink);
     break;
   case FORMAT_COMMONMARK:
-    result = cmark_render_commonmark_with_mem(document, options, width, mem);
+    status = cmark_render_commonmark_to_sink(document, options, width, &sink);
     break;
   case FORMAT_PLAINTEXT:
-    result = cmark_render_plaintext_with_mem(document, options, width, mem);
+    status = cmark_render_plaintext_to_sink(document, options, width, &sink);
     break;
   case FORMAT_LATEX:
-    result = cmark_render_latex_with_mem(document, options, width, mem);
+    status = cmark_render_latex_to_sink(document, options, width, &sink);
     break;
   default:
     fprintf(stderr, "Unknown format %d\n", writer);
     return false;
   }
-  printf("%s", result);
-  mem->free(result);
 
-  return true;
+  return status == 0;
 }
 
 static void print_extensions(void) {
@@ -127,6 +151,9 @@ int main(int argc, char *argv[]) {
   size_t bytes;
   cmark_node *document = NULL;
   int width = 0;
+  int threads = 1;
+  bool use_arena = false;
+  input_buffer input = {NULL, 0, 0};
   char *unparsed;
   writer_format writer = FORMAT_HTML;
   int options = CMARK_OPT_DEFAULT;
@@ -202,6 +229,19 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "--width requires an argument\n");
         goto failure;
       }
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      i += 1;
+      if (i < argc) {
+        threads = (int)strtol(argv[i], &unparsed, 10);
+        if (unparsed && strlen(unparsed) > 0) {
+          fprintf(stderr, "failed parsing threads '%s' at '%s'\n", argv[i],
+                  unparsed);
+          goto failure;
+        }
+      } else {
+        fprintf(stderr, "--threads requires an argument\n");
+        goto failure;
+      }
     } else if ((strcmp(argv[i], "-t") == 0) || (strcmp(argv[i], "--to") == 0)) {
       i += 1;
       if (i < argc) {
@@ -240,12 +280,17 @@ int main(int argc, char *argv[]) {
     }
   }
 
-#if DEBUG
-  parser = cmark_parser_new(options);
-#else
-  parser = cmark_parser_new_with_mem(options, cmark_get_arena_mem_allocator());
+#if !DEBUG
+  // The arena allocator can only be used from this thread.
+  use_arena = threads < 2;
 #endif
 
+  if (use_arena)
+    parser = cmark_parser_new_with_mem(options, cmark_get_arena_mem_allocator());
+  else
+    parser = cmark_parser_new(options);
+  cmark_parser_set_threads(parser, threads);
+
   for (i = 1; i < argc; i++) {
     if ((strcmp(argv[i], "-e") == 0) || (strcmp(argv[i], "--extension") == 0)) {
       i += 1;
@@ -275,7 +320,7 @@ int main(int argc, char *argv[]) {
     }
 
     while ((bytes = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
-      cmark_parser_feed(parser, buffer, bytes);
+      feed_input(parser, &input, buffer, bytes);
       if (bytes < sizeof(buffer)) {
         break;
       }
@@ -286,7 +331,7 @@ int main(int argc, char *argv[]) {
 
   if (numfps == 0) {
     while ((bytes = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
-      cmark_parser_feed(parser, buffer, bytes);
+      feed_input(parser, &input, buffer, bytes);
       if (bytes < sizeof(buffer)) {
         break;
       }
@@ -300,7 +345,10 @@ int main(int argc, char *argv[]) {
   }
 #endif
 
-  document = cmark_parser_finish(parser);
+  if (parser->threads > 1)
+    document = cmark_parser_parse_document(parser, input.data, input.size);
+  else
+    document = cmark_parser_finish(parser);
 
   if (!document || !print_document(document, writer, options, width, parser))
     goto failure;
@@ -310,18 +358,19 @@ success:
 
 failure:
 
-#if DEBUG
-  if (parser)
-  cmark_parser_free(parser);
+  if (use_arena) {
+    cmark_arena_reset();
+  } else {
+    if (parser)
+      cmark_parser_free(parser);
 
-  if (document)
-    cmark_node_free(document);
-#else
-  cmark_arena_reset();
-#endif
+    if (document)
+      cmark_node_free(document);
+  }
 
   cmark_release_plugins();
 
+  free(input.data);
   free(files);
 
   return res;
@@ -11,8 +11,11 @@
 #include "render.h"
 #include "syntax_extension.h"
 
-#define OUT(s, wrap, escaping) renderer->out(renderer, node, s, wrap, escaping)
-#define LIT(s) renderer->out(renderer, node, s, false, LITERAL)
+#define OUT(s, wrap, escaping) cmark_render_out(renderer, node, s, wrap, escaping)
+#define OUT_LEN(s, len, wrap, escaping)                                        \
+  renderer->out_len(renderer, node, (const char *)(s), (bufsize_t)(len), wrap, \
+                    escaping)
+#define LIT(s) cmark_render_out(renderer, node, s, false, LITERAL)
 #define CR() renderer->cr(renderer)
 #define BLANKLINE() renderer->blankline(renderer)
 #define LIST_NUMBER_SIZE 20
@@ -130,8 +133,10 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
           list_number += 1;
         }
         char list_number_s[LIST_NUMBER_SIZE];
-        snprintf(list_number_s, LIST_NUMBER_SIZE, "\"%d.\" 4", list_number);
+        cmark_int_to_cstr(list_number_s, list_number);
+        LIT("\"");
         LIT(list_number_s);
+        LIT(".\" 4");
       }
       CR();
     } else {
@@ -152,7 +157,8 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
   case CMARK_NODE_CODE_BLOCK:
     CR();
     LIT(".IP\n.nf\n\\f[C]\n");
-    OUT(cmark_node_get_literal(node), false, NORMAL);
+    OUT_LEN(node->as.code.literal.data, node->as.code.literal.len, false,
+            NORMAL);
     CR();
     LIT("\\f[]\n.fi");
     CR();
@@ -191,7 +197,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_TEXT:
-    OUT(cmark_node_get_literal(node), allow_wrap, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, NORMAL);
     break;
 
   case CMARK_NODE_LINEBREAK:
@@ -212,7 +218,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
 
   case CMARK_NODE_CODE:
     LIT("\\f[C]");
-    OUT(cmark_node_get_literal(node), allow_wrap, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, NORMAL);
     LIT("\\f[]");
     break;
 
@@ -276,3 +282,8 @@ char *cmark_render_man(cmark_node *root, int options, int width) {
 char *cmark_render_man_with_mem(cmark_node *root, int options, int width, cmark_mem *mem) {
   return cmark_render(mem, root, options, width, S_outc, S_render_node);
 }
+
+int cmark_render_man_to_sink(cmark_node *root, int options, int width, cmark_sink *sink) {
+  return cmark_render_to_sink(cmark_node_mem(root), root, options, width, S_outc,
+                              S_render_node, sink);
+}
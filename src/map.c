@@ -2,6 +2,69 @@
 #include "utf8.h"
 #include "parser.h"
 
+#define HASH_INIT(seed) (2166136261u ^ (seed))
+#define HASH_STEP(h, c) (((h) ^ (c)) * 16777619u)
+
+// Seeded FNV-1a, with a final avalanche so that the low bits used to
+// pick a slot depend on every byte of the label.
+static CMARK_INLINE unsigned int hash_final(uint32_t h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
+static unsigned int map_hash(const cmark_map *map, const unsigned char *label) {
+  uint32_t h = HASH_INIT(map->seed);
+
+  while (*label)
+    h = HASH_STEP(h, *label++);
+
+  return hash_final(h);
+}
+
+// Fast path for labels made up only of ASCII: case folds, trims and
+// collapses whitespace in a single pass, writing into 'out' (which must
+// hold ref->len + 1 bytes) and hashing the result on the way.
+// Returns the normalized length, or -1 if the label contains bytes that
+// need the full Unicode case fold.
+static bufsize_t normalize_ascii_label(const cmark_chunk *ref,
+                                       unsigned char *out, uint32_t seed,
+                                       unsigned int *hash) {
+  uint32_t h = HASH_INIT(seed);
+  bool pending_space = false;
+  bufsize_t r, w = 0;
+
+  for (r = 0; r < ref->len; ++r) {
+    unsigned char c = ref->data[r];
+
+    if (c == 0 || c >= 0x80)
+      return -1;
+
+    if (cmark_isspace(c)) {
+      pending_space = w > 0;
+      continue;
+    }
+
+    if (pending_space) {
+      out[w++] = ' ';
+      h = HASH_STEP(h, ' ');
+      pending_space = false;
+    }
+
+    if (c >= 'A' && c <= 'Z')
+      c += 'a' - 'A';
+    out[w++] = c;
+    h = HASH_STEP(h, c);
+  }
+
+  out[w] = '\0';
+  *hash = hash_final(h);
+  return w;
+}
+
 // normalize map label:  collapse internal whitespace to single space,
 // remove leading/trailing whitespace, case fold
 // Return NULL if the label is actually empty (i.e. composed solely from
@@ -9,6 +72,7 @@
 unsigned char *normalize_map_label(cmark_mem *mem, cmark_chunk *ref) {
   cmark_strbuf normalized = CMARK_BUF_INIT(mem);
   unsigned char *result;
+  unsigned int hash;
 
   if (ref == NULL)
     return NULL;
@@ -16,12 +80,17 @@ unsigned char *normalize_map_label(cmark_mem *mem, cmark_chunk *ref) {
   if (ref->len == 0)
     return NULL;
 
-  cmark_utf8proc_case_fold(&normalized, ref->data, ref->len);
-  cmark_strbuf_trim(&normalized);
-  cmark_strbuf_normalize_whitespace(&normalized);
+  result = (unsigned char *)mem->calloc(ref->len + 1, 1);
+  if (normalize_ascii_label(ref, result, 0, &hash) < 0) {
+    mem->free(result);
 
-  result = cmark_strbuf_detach(&normalized);
-  assert(result);
+    cmark_utf8proc_case_fold(&normalized, ref->data, ref->len);
+    cmark_strbuf_trim(&normalized);
+    cmark_strbuf_normalize_whitespace(&normalized);
+
+    result = cmark_strbuf_detach(&normalized);
+    assert(result);
+  }
 
   if (result[0] == '\0') {
     mem->free(result);
@@ -31,70 +100,110 @@ unsigned char *normalize_map_label(cmark_mem *mem, cmark_chunk *ref) {
   return result;
 }
 
-static int
-labelcmp(const unsigned char *a, const unsigned char *b) {
-  return strcmp((const char *)a, (const char *)b);
+static void map_index(cmark_map *map, cmark_map_entry *entry) {
+  unsigned int mask = map->table_size - 1;
+  unsigned int i = entry->hash & mask;
+
+  while (map->table[i])
+    i = (i + 1) & mask;
+
+  map->table[i] = entry;
+  map->table_used++;
 }
 
-static int
-refcmp(const void *p1, const void *p2) {
-  cmark_map_entry *r1 = *(cmark_map_entry **)p1;
-  cmark_map_entry *r2 = *(cmark_map_entry **)p2;
-  int res = labelcmp(r1->label, r2->label);
-  return res ? res : ((int)r1->age - (int)r2->age);
+static void map_grow(cmark_map *map) {
+  cmark_map_entry **old = map->table;
+  unsigned int i, old_size = map->table_size;
+
+  map->table_size = old_size ? old_size * 2 : 16;
+  map->table = (cmark_map_entry **)map->mem->calloc(map->table_size,
+                                                    sizeof(cmark_map_entry *));
+  map->table_used = 0;
+
+  for (i = 0; i < old_size; i++) {
+    if (old[i])
+      map_index(map, old[i]);
+  }
+
+  map->mem->free(old);
 }
 
-static int
-refsearch(const void *label, const void *p2) {
-  cmark_map_entry *ref = *(cmark_map_entry **)p2;
-  return labelcmp((const unsigned char *)label, ref->label);
+static cmark_map_entry *map_find(cmark_map *map, const unsigned char *label,
+                                 unsigned int hash) {
+  unsigned int mask = map->table_size - 1;
+  unsigned int i = hash & mask;
+  cmark_map_entry *entry;
+
+  while ((entry = map->table[i]) != NULL) {
+    if (entry->hash == hash &&
+        strcmp((const char *)entry->label, (const char *)label) == 0)
+      return entry;
+    i = (i + 1) & mask;
+  }
+
+  return NULL;
 }
 
-static void sort_map(cmark_map *map) {
-  unsigned int i = 0, last = 0, size = map->size;
-  cmark_map_entry *r = map->refs, **sorted = NULL;
+// Take ownership of 'entry', whose label must already be normalized.
+// Only the first entry added for a given label can be looked up.
+void cmark_map_insert(cmark_map *map, cmark_map_entry *entry) {
+  entry->hash = map_hash(map, entry->label);
+  entry->age = map->size;
+  entry->next = map->refs;
 
-  sorted = (cmark_map_entry **)map->mem->calloc(size, sizeof(cmark_map_entry *));
-  while (r) {
-    sorted[i++] = r;
-    r = r->next;
-  }
+  map->refs = entry;
+  map->size++;
 
-  qsort(sorted, size, sizeof(cmark_map_entry *), refcmp);
+  // Keep the load factor below 3/4.
+  if ((map->table_used + 1) * 4 > map->table_size * 3)
+    map_grow(map);
 
-  for (i = 1; i < size; i++) {
-    if (labelcmp(sorted[i]->label, sorted[last]->label) != 0)
-      sorted[++last] = sorted[i];
+  if (!map_find(map, entry->label, entry->hash))
+    map_index(map, entry);
+}
+
+// Move every entry of 'other' into 'map', after those already there, as
+// if they had been inserted in the same order, and free 'other'.
+void cmark_map_merge(cmark_map *map, cmark_map *other) {
+  cmark_map_entry *entry, *next, *reversed = NULL;
+
+  for (entry = other->refs; entry; entry = next) {
+    next = entry->next;
+    entry->next = reversed;
+    reversed = entry;
+  }
+  for (entry = reversed; entry; entry = next) {
+    next = entry->next;
+    cmark_map_insert(map, entry);
   }
 
-  map->sorted = sorted;
-  map->size = last + 1;
+  other->refs = NULL;
+  cmark_map_free(other);
 }
 
 cmark_map_entry *cmark_map_lookup(cmark_map *map, cmark_chunk *label) {
-  cmark_map_entry **ref = NULL;
+  cmark_map_entry *ref = NULL;
+  unsigned char buf[MAX_LINK_LABEL_LENGTH + 1];
   unsigned char *norm;
+  unsigned int hash;
 
   if (label->len < 1 || label->len > MAX_LINK_LABEL_LENGTH)
     return NULL;
 
-  if (map == NULL || !map->size)
+  if (map == NULL || !map->table_used)
     return NULL;
 
+  if (normalize_ascii_label(label, buf, map->seed, &hash) >= 0)
+    return buf[0] ? map_find(map, buf, hash) : NULL;
+
   norm = normalize_map_label(map->mem, label);
   if (norm == NULL)
     return NULL;
 
-  if (!map->sorted)
-    sort_map(map);
-
-  ref = (cmark_map_entry **)bsearch(norm, map->sorted, map->size, sizeof(cmark_map_entry *), refsearch);
+  ref = map_find(map, norm, map_hash(map, norm));
   map->mem->free(norm);
 
-  if (!ref)
-    return NULL;
-
-  return ref[0];
+  return ref;
 }
 
 void cmark_map_free(cmark_map *map) {
@@ -110,7 +219,7 @@ void cmark_map_free(cmark_map *map) {
     ref = next;
   }
 
-  map->mem->free(map->sorted);
+  map->mem->free(map->table);
   map->mem->free(map);
 }
 
@@ -118,5 +227,10 @@ cmark_map *cmark_map_new(cmark_mem *mem, cmark_map_free_f free) {
   cmark_map *map = (cmark_map *)mem->calloc(1, sizeof(cmark_map));
   map->mem = mem;
   map->free = free;
+  // Derive the hash seed from the map's address, so that colliding
+  // labels cannot be precomputed (see the "reference collisions" case
+  // in test/pathological_tests.py).
+  map->seed = (unsigned int)((uint64_t)(uintptr_t)map ^
+                              ((uint64_t)(uintptr_t)map >> 32));
   return map;
 }
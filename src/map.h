@@ -11,6 +11,7 @@ struct cmark_map_entry {
   struct cmark_map_entry *next;
   unsigned char *label;
   unsigned int age;
+  unsigned int hash;
 };
 
 typedef struct cmark_map_entry cmark_map_entry;
@@ -21,8 +22,13 @@ typedef void (*cmark_map_free_f)(struct cmark_map *, cmark_map_entry *);
 
 struct cmark_map {
   cmark_mem *mem;
+  /* every entry added, most recent first; owns the entries */
   cmark_map_entry *refs;
-  cmark_map_entry **sorted;
+  /* open-addressing index of the first entry for each label */
+  cmark_map_entry **table;
+  unsigned int table_size;
+  unsigned int table_used;
+  unsigned int seed;
   unsigned int size;
   cmark_map_free_f free;
 };
@@ -32,6 +38,8 @@ typedef struct cmark_map cmark_map;
 unsigned char *normalize_map_label(cmark_mem *mem, cmark_chunk *ref);
 cmark_map *cmark_map_new(cmark_mem *mem, cmark_map_free_f free);
 void cmark_map_free(cmark_map *map);
+void cmark_map_insert(cmark_map *map, cmark_map_entry *entry);
+void cmark_map_merge(cmark_map *map, cmark_map *other);
 cmark_map_entry *cmark_map_lookup(cmark_map *map, cmark_chunk *label);
 
 #ifdef __cplusplus
@@ -3,6 +3,7 @@
 
 #include "config.h"
 #include "node.h"
+#include "map.h"
 #include "syntax_extension.h"
 
 static void S_node_unlink(cmark_node *node);
@@ -99,6 +100,98 @@ cmark_node *cmark_node_new_with_mem_and_ext(cmark_node_type type, cmark_mem *mem
   return node;
 }
 
+// Pools start with small slabs, so that short documents don't pay for
+// zeroing memory they never use, and double them up to the maximum.
+#define NODE_POOL_MIN_SLAB 2048
+#define NODE_POOL_MAX_SLAB (64 * 1024)
+
+struct cmark_node_slab {
+  cmark_node_slab *next;
+};
+
+// Nodes start this far into a slab, keeping them aligned.
+#define NODE_SLAB_HEADER ((sizeof(cmark_node_slab) + 15) & ~(size_t)15)
+
+cmark_node_pool *cmark_node_pool_new(cmark_mem *mem) {
+  cmark_node_pool *pool =
+      (cmark_node_pool *)mem->calloc(1, sizeof(cmark_node_pool));
+  pool->mem = *mem;
+  pool->base = mem;
+  pool->slab_size = NODE_POOL_MIN_SLAB;
+  return pool;
+}
+
+static void S_pool_free(cmark_node_pool *pool) {
+  cmark_node_slab *slab, *next;
+
+  for (slab = pool->slabs; slab; slab = next) {
+    next = slab->next;
+    pool->base->free(slab);
+  }
+  pool->base->free(pool);
+}
+
+void cmark_node_pool_release(cmark_node_pool *pool) {
+  if (pool->live == 0)
+    S_pool_free(pool);
+  else
+    pool->released = true;
+}
+
+static void S_pool_add_slab(cmark_node_pool *pool) {
+  cmark_node_slab *slab =
+      (cmark_node_slab *)pool->base->calloc(1, pool->slab_size);
+
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  pool->cur = (unsigned char *)slab + NODE_SLAB_HEADER;
+  pool->end = (unsigned char *)slab + pool->slab_size;
+  if (pool->slab_size < NODE_POOL_MAX_SLAB)
+    pool->slab_size *= 2;
+}
+
+cmark_node *cmark_node_pool_alloc(cmark_node_pool *pool) {
+  cmark_node *node = pool->free_nodes;
+
+  if (node) {
+    pool->free_nodes = node->next;
+    memset(node, 0, sizeof(cmark_node));
+  } else {
+    if ((size_t)(pool->end - pool->cur) < sizeof(cmark_node))
+      S_pool_add_slab(pool);
+    node = (cmark_node *)pool->cur;
+    pool->cur += sizeof(cmark_node);
+  }
+
+  node->flags = CMARK_NODE__POOLED;
+  cmark_strbuf_init(&pool->mem, &node->content, 0);
+  pool->live++;
+  return node;
+}
+
+// Give a pooled node back.  Once the pool is released nothing will
+// reuse the node, so only the count of live nodes has to be kept.
+static void S_pool_free_node(cmark_node *node) {
+  cmark_node_pool *pool = (cmark_node_pool *)node->content.mem;
+
+  if (pool->released) {
+    if (--pool->live == 0)
+      S_pool_free(pool);
+    return;
+  }
+
+  node->next = pool->free_nodes;
+  pool->free_nodes = node;
+  pool->live--;
+}
+
+cmark_node *cmark_node_new_inline(cmark_node_pool *pool, cmark_node_type type) {
+  cmark_node *node = cmark_node_pool_alloc(pool);
+
+  node->type = (uint16_t)type;
+  return node;
+}
+
 cmark_node *cmark_node_new_with_ext(cmark_node_type type, cmark_syntax_extension *extension) {
   extern cmark_mem CMARK_DEFAULT_MEM_ALLOCATOR;
   return cmark_node_new_with_mem_and_ext(type, &CMARK_DEFAULT_MEM_ALLOCATOR, extension);
@@ -115,6 +208,9 @@ cmark_node *cmark_node_new(cmark_node_type type) {
 
 static void free_node_as(cmark_node *node) {
   switch (node->type) {
+    case CMARK_NODE_DOCUMENT:
+    cmark_map_free(node->as.refmap);
+      break;
     case CMARK_NODE_CODE_BLOCK:
     cmark_chunk_free(NODE_MEM(node), &node->as.code.info);
     cmark_chunk_free(NODE_MEM(node), &node->as.code.literal);
@@ -162,7 +258,10 @@ static void S_free_nodes(cmark_node *e) {
       e->next = e->first_child;
     }
     next = e->next;
-    NODE_MEM(e)->free(e);
+    if (e->flags & CMARK_NODE__POOLED)
+      S_pool_free_node(e);
+    else
+      NODE_MEM(e)->free(e);
     e = next;
   }
 }
@@ -52,6 +52,10 @@ enum cmark_node__internal_flags {
   CMARK_NODE__OPEN = (1 << 0),
   CMARK_NODE__LAST_LINE_BLANK = (1 << 1),
   CMARK_NODE__LAST_LINE_CHECKED = (1 << 2),
+  // A link label in the block's inlines matched no reference definition.
+  CMARK_NODE__MISSED_LABEL = (1 << 3),
+  // Allocated from a cmark_node_pool, which 'content.mem' points to.
+  CMARK_NODE__POOLED = (1 << 4),
 };
 
 struct cmark_node {
@@ -84,11 +88,49 @@ struct cmark_node {
     cmark_link link;
     cmark_custom custom;
     int html_block_type;
+    // The link reference definitions of a parsed document.
+    struct cmark_map *refmap;
     void *opaque;
   } as;
 };
 
+
+// The nodes made while parsing a document are carved out of slabs that
+// belong to a pool, instead of being allocated one by one.  Freed nodes
+// are reused until the parser releases the pool; after that, the slabs
+// are freed together with the last node.
+typedef struct cmark_node_slab cmark_node_slab;
+
+typedef struct cmark_node_pool {
+  // A copy of *base that the 'content.mem' of pooled nodes points to,
+  // so that their content buffers can be used like any other.
+  cmark_mem mem;
+  cmark_mem *base;
+  cmark_node_slab *slabs;
+  unsigned char *cur;
+  unsigned char *end;
+  size_t slab_size;
+  // Freed nodes, linked through 'next'.
+  cmark_node *free_nodes;
+  // Nodes allocated and not yet freed.
+  size_t live;
+  bool released;
+} cmark_node_pool;
+
+cmark_node_pool *cmark_node_pool_new(cmark_mem *mem);
+
+// Stop allocating from 'pool'.  It is freed right away if it has no
+// nodes left, or else along with the last of them.
+void cmark_node_pool_release(cmark_node_pool *pool);
+
+// Allocate a zeroed node with an empty 'content'.  Only 'mem' and
+// 'flags' are set.  A pool may only be used by one thread at a time.
+cmark_node *cmark_node_pool_alloc(cmark_node_pool *pool);
+
+// The allocator of 'node' and of everything it holds.
 static CMARK_INLINE cmark_mem *cmark_node_mem(cmark_node *node) {
+  if (node->flags & CMARK_NODE__POOLED)
+    return ((cmark_node_pool *)node->content.mem)->base;
   return node->content.mem;
 }
 CMARK_GFM_EXPORT int cmark_node_check(cmark_node *node, FILE *out);
@@ -111,6 +153,9 @@ static CMARK_INLINE bool CMARK_NODE_INLINE_P(cmark_node *node) {
 
 CMARK_GFM_EXPORT bool cmark_node_can_contain_type(cmark_node *node, cmark_node_type child_type);
 
+// Allocate an inline node of 'type' for the parser from 'pool'.
+cmark_node *cmark_node_new_inline(cmark_node_pool *pool, cmark_node_type type);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,99 @@
+#include <stdlib.h>
+
+#include "parallel.h"
+
+#if defined(HAVE_PTHREAD)
+#include <pthread.h>
+
+typedef pthread_t thread_handle;
+
+typedef struct {
+  cmark_parallel_func func;
+  void *arg;
+} thread_start;
+
+static void *thread_main(void *data) {
+  thread_start *start = (thread_start *)data;
+  start->func(start->arg);
+  return NULL;
+}
+
+static int thread_create(thread_handle *thread, thread_start *start) {
+  return pthread_create(thread, NULL, thread_main, start) == 0;
+}
+
+static void thread_join(thread_handle thread) { pthread_join(thread, NULL); }
+
+#elif defined(HAVE_WIN32_THREADS)
+#include <windows.h>
+#include <process.h>
+
+typedef HANDLE thread_handle;
+
+typedef struct {
+  cmark_parallel_func func;
+  void *arg;
+} thread_start;
+
+static unsigned __stdcall thread_main(void *data) {
+  thread_start *start = (thread_start *)data;
+  start->func(start->arg);
+  return 0;
+}
+
+static int thread_create(thread_handle *thread, thread_start *start) {
+  *thread = (HANDLE)_beginthreadex(NULL, 0, thread_main, start, 0, NULL);
+  return *thread != 0;
+}
+
+static void thread_join(thread_handle thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+#endif
+
+void cmark_parallel_run(cmark_parallel_func func, void *args, size_t size,
+                        int count) {
+  char *base = (char *)args;
+  int i;
+
+#if defined(HAVE_PTHREAD) || defined(HAVE_WIN32_THREADS)
+  if (count > 1) {
+    thread_handle *threads =
+        (thread_handle *)calloc((size_t)count, sizeof(thread_handle));
+    thread_start *starts =
+        (thread_start *)calloc((size_t)count, sizeof(thread_start));
+    char *started = (char *)calloc((size_t)count, 1);
+
+    if (threads && starts && started) {
+      for (i = 1; i < count; ++i) {
+        starts[i].func = func;
+        starts[i].arg = base + (size_t)i * size;
+        started[i] = (char)thread_create(&threads[i], &starts[i]);
+      }
+
+      func(base);
+
+      for (i = 1; i < count; ++i) {
+        if (started[i])
+          thread_join(threads[i]);
+        else
+          func(base + (size_t)i * size);
+      }
+
+      free(threads);
+      free(starts);
+      free(started);
+      return;
+    }
+
+    free(threads);
+    free(starts);
+    free(started);
+  }
+#endif
+
+  for (i = 0; i < count; ++i)
+    func(base + (size_t)i * size);
+}
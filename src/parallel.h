@@ -0,0 +1,26 @@
+#ifndef CMARK_PARALLEL_H
+#define CMARK_PARALLEL_H
+
+#include <stddef.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*cmark_parallel_func)(void *arg);
+
+/** Calls 'func' once for each of the 'count' elements of 'args', which
+ * are 'size' bytes apart, each call on a thread of its own.  The first
+ * call runs on the calling thread; so does any call for which a thread
+ * cannot be started, or all of them when the library was built without
+ * thread support.  Returns once every call has returned.
+ */
+void cmark_parallel_run(cmark_parallel_func func, void *args, size_t size,
+                        int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
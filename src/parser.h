@@ -18,6 +18,8 @@ struct cmark_parser {
   struct cmark_map *refmap;
   /* The root node of the parser, always a CMARK_NODE_DOCUMENT */
   struct cmark_node *root;
+  /* Where the nodes of the current document are allocated */
+  cmark_node_pool *pool;
   /* The last open block after a line is fully processed */
   struct cmark_node *current;
   /* See the documentation for cmark_parser_get_line_number() in cmark.h */
@@ -37,17 +39,30 @@ struct cmark_parser {
   bool blank;
   /* See the documentation for cmark_parser_has_partially_consumed_tab() in cmark.h */
   bool partially_consumed_tab;
-  /* Contains the currently processed line */
+  /* Holds the currently processed line when it cannot be parsed in place */
   cmark_strbuf curline;
+  /* The currently processed line: either curline or a complete line in
+   * the caller's buffer.  Empty between lines. */
+  cmark_chunk line;
   /* See the documentation for cmark_parser_get_last_line_length() in cmark.h */
   bufsize_t last_line_length;
   /* FIXME: not sure about the difference with curline */
   cmark_strbuf linebuf;
   /* Options set by the user, see the Options section in cmark.h */
   int options;
+  /* See the documentation for cmark_parser_set_threads() in cmark.h */
+  int threads;
+  /* See the documentation for cmark_parser_set_block_callback() in cmark.h */
+  cmark_block_callback block_callback;
+  void *block_callback_data;
+  cmark_stream_mode stream_mode;
+  /* Set once a streamed block is held back to wait for definitions */
+  bool holding_blocks;
   bool last_buffer_ended_with_cr;
   cmark_llist *syntax_extensions;
   cmark_llist *inline_syntax_extensions;
+  /* Built from inline_syntax_extensions, see cmark_inlines_update_special_chars() */
+  struct cmark_special_chars *special_chars;
   cmark_ispunct_func backslash_ispunct;
 };
 
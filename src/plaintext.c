@@ -2,8 +2,11 @@
 #include "syntax_extension.h"
 #include "render.h"
 
-#define OUT(s, wrap, escaping) renderer->out(renderer, node, s, wrap, escaping)
-#define LIT(s) renderer->out(renderer, node, s, false, LITERAL)
+#define OUT(s, wrap, escaping) cmark_render_out(renderer, node, s, wrap, escaping)
+#define OUT_LEN(s, len, wrap, escaping)                                        \
+  renderer->out_len(renderer, node, (const char *)(s), (bufsize_t)(len), wrap, \
+                    escaping)
+#define LIT(s) cmark_render_out(renderer, node, s, false, LITERAL)
 #define CR() renderer->cr(renderer)
 #define BLANKLINE() renderer->blankline(renderer)
 #define LISTMARKER_SIZE 20
@@ -89,10 +92,12 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
       // we ensure a width of at least 4 so
       // we get nice transition from single digits
       // to double
-      snprintf(listmarker, LISTMARKER_SIZE, "%d%s%s", list_number,
-               list_delim == CMARK_PAREN_DELIM ? ")" : ".",
-               list_number < 10 ? "  " : " ");
-      marker_width = (bufsize_t)strlen(listmarker);
+      marker_width = cmark_int_to_cstr(listmarker, list_number);
+      listmarker[marker_width++] = list_delim == CMARK_PAREN_DELIM ? ')' : '.';
+      listmarker[marker_width++] = ' ';
+      if (list_number < 10)
+        listmarker[marker_width++] = ' ';
+      listmarker[marker_width] = '\0';
     }
     if (entering) {
       if (cmark_node_get_list_type(node->parent) == CMARK_BULLET_LIST) {
@@ -129,7 +134,8 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     if (!first_in_list_item) {
       BLANKLINE();
     }
-    OUT(cmark_node_get_literal(node), false, LITERAL);
+    OUT_LEN(node->as.code.literal.data, node->as.code.literal.len, false,
+            LITERAL);
     BLANKLINE();
     break;
 
@@ -150,7 +156,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_TEXT:
-    OUT(cmark_node_get_literal(node), allow_wrap, NORMAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, NORMAL);
     break;
 
   case CMARK_NODE_LINEBREAK:
@@ -170,7 +176,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     break;
 
   case CMARK_NODE_CODE:
-    OUT(cmark_node_get_literal(node), allow_wrap, LITERAL);
+    OUT_LEN(node->as.literal.data, node->as.literal.len, allow_wrap, LITERAL);
     break;
 
   case CMARK_NODE_HTML_INLINE:
@@ -194,7 +200,7 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
   case CMARK_NODE_FOOTNOTE_REFERENCE:
     if (entering) {
       LIT("[^");
-      OUT(cmark_chunk_to_cstr(renderer->mem, &node->as.literal), false, LITERAL);
+      OUT_LEN(node->as.literal.data, node->as.literal.len, false, LITERAL);
       LIT("]");
     }
     break;
@@ -203,8 +209,8 @@ static int S_render_node(cmark_renderer *renderer, cmark_node *node,
     if (entering) {
       renderer->footnote_ix += 1;
       LIT("[^");
-      char n[32];
-      snprintf(n, sizeof(n), "%d", renderer->footnote_ix);
+      char n[CMARK_INT_BUFSIZE];
+      cmark_int_to_cstr(n, (int)renderer->footnote_ix);
       OUT(n, false, LITERAL);
       LIT("]: ");
 
@@ -233,3 +239,13 @@ char *cmark_render_plaintext_with_mem(cmark_node *root, int options, int width,
   }
   return cmark_render(mem, root, options, width, outc, S_render_node);
 }
+
+int cmark_render_plaintext_to_sink(cmark_node *root, int options, int width, cmark_sink *sink) {
+  if (options & CMARK_OPT_HARDBREAKS) {
+    // disable breaking on width, since it has
+    // a different meaning with OPT_HARDBREAKS
+    width = 0;
+  }
+  return cmark_render_to_sink(cmark_node_mem(root), root, options, width, outc,
+                              S_render_node, sink);
+}
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "cmark-gfm.h"
 #include "parser.h"
 #include "references.h"
@@ -24,19 +26,45 @@ void cmark_reference_create(cmark_map *map, cmark_chunk *label,
   if (reflabel == NULL)
     return;
 
-  assert(map->sorted == NULL);
-
   ref = (cmark_reference *)map->mem->calloc(1, sizeof(*ref));
   ref->entry.label = reflabel;
   ref->url = cmark_clean_url(map->mem, url);
   ref->title = cmark_clean_title(map->mem, title);
-  ref->entry.age = map->size;
-  ref->entry.next = map->refs;
 
-  map->refs = (cmark_map_entry *)ref;
-  map->size++;
+  cmark_map_insert(map, &ref->entry);
 }
 
 cmark_map *cmark_reference_map_new(cmark_mem *mem) {
   return cmark_map_new(mem, reference_free);
 }
+
+bool cmark_may_define_labels(const unsigned char *data, size_t len) {
+  const unsigned char *p = data, *end = data + len;
+
+  while ((p = (const unsigned char *)memchr(p, ']', (size_t)(end - p))) &&
+         ++p < end) {
+    if (*p == ':')
+      return true;
+  }
+  return false;
+}
+
+static bool S_chunks_equal(const cmark_chunk *a, const cmark_chunk *b) {
+  return a->len == b->len && (a->len == 0 || !memcmp(a->data, b->data, (size_t)a->len));
+}
+
+bool cmark_reference_maps_equal(cmark_map *a, cmark_map *b) {
+  cmark_map_entry *x = a->refs, *y = b->refs;
+
+  if (a->size != b->size)
+    return false;
+  for (; x && y; x = x->next, y = y->next) {
+    cmark_reference *r = (cmark_reference *)x, *s = (cmark_reference *)y;
+
+    if (strcmp((const char *)x->label, (const char *)y->label) ||
+        !S_chunks_equal(&r->url, &s->url) ||
+        !S_chunks_equal(&r->title, &s->title))
+      return false;
+  }
+  return x == y;
+}
@@ -19,6 +19,13 @@ void cmark_reference_create(cmark_map *map, cmark_chunk *label,
                             cmark_chunk *url, cmark_chunk *title);
 cmark_map *cmark_reference_map_new(cmark_mem *mem);
 
+// Whether the 'len' bytes at 'data' may hold a link reference or
+// footnote definition.  Both need a label directly followed by a colon.
+bool cmark_may_define_labels(const unsigned char *data, size_t len);
+
+// Whether 'a' and 'b' hold the same definitions, added in the same order.
+bool cmark_reference_maps_equal(cmark_map *a, cmark_map *b);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,3 +1,4 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include "buffer.h"
 #include "chunk.h"
@@ -19,27 +20,46 @@ static CMARK_INLINE void S_blankline(cmark_renderer *renderer) {
   }
 }
 
-static void S_out(cmark_renderer *renderer, cmark_node *node,
-                  const char *source, bool wrap,
-                  cmark_escaping escape) {
-  int length = (int)strlen(source);
+// The extension whose commonmark_escape_func applies to output for
+// 'node': that of its nearest ancestor-or-self with an extension.
+static cmark_syntax_extension *S_find_escape_ext(cmark_node *node) {
+  while (node && !node->extension)
+    node = node->parent;
+  if (node && node->extension->commonmark_escape_func)
+    return node->extension;
+  return NULL;
+}
+
+// Update the escaping extension as the render loop moves to 'node'.
+// Coming from its parent, a sibling or a child, it is known without
+// walking up the tree, unless the node just left had its own extension.
+static void S_track_escape_ext(cmark_renderer *renderer, cmark_node *node) {
+  cmark_node *last = renderer->escape_node;
+
+  if (node->extension) {
+    renderer->escape_ext =
+        node->extension->commonmark_escape_func ? node->extension : NULL;
+  } else if (!last || !(node->parent == last ||
+                        (!last->extension && (last->parent == node->parent ||
+                                              last->parent == node)))) {
+    renderer->escape_ext = S_find_escape_ext(node);
+  }
+  renderer->escape_node = node;
+}
+
+static void S_out_len(cmark_renderer *renderer, cmark_node *node,
+                      const char *source, bufsize_t length, bool wrap,
+                      cmark_escaping escape) {
   unsigned char nextc;
   int32_t c;
-  int i = 0;
+  bufsize_t i = 0;
   int last_nonspace;
   int len;
   cmark_chunk remainder = cmark_chunk_literal("");
   int k = renderer->buffer->size - 1;
-
-  cmark_syntax_extension *ext = NULL;
-  cmark_node *n = node;
-  while (n && !ext) {
-    ext = n->extension;
-    if (!ext)
-      n = n->parent;
-  }
-  if (ext && !ext->commonmark_escape_func)
-    ext = NULL;
+  cmark_syntax_extension *ext = node == renderer->escape_node
+                                    ? renderer->escape_ext
+                                    : S_find_escape_ext(node);
 
   wrap = wrap && !renderer->no_linebreaks;
 
@@ -79,7 +99,7 @@ static void S_out(cmark_renderer *renderer, cmark_node *node,
     if (ext && ext->commonmark_escape_func(ext, node, c))
       cmark_strbuf_putc(renderer->buffer, '\\');
 
-    nextc = source[i + len];
+    nextc = i + len < length ? source[i + len] : 0;
     if (c == 32 && wrap) {
       if (!renderer->begin_line) {
         last_nonspace = renderer->buffer->size;
@@ -88,12 +108,12 @@ static void S_out(cmark_renderer *renderer, cmark_node *node,
         renderer->begin_line = false;
         renderer->begin_content = false;
         // skip following spaces
-        while (source[i + 1] == ' ') {
+        while (i + 1 < length && source[i + 1] == ' ') {
           i++;
         }
         // We don't allow breaks that make a digit the first character
         // because this causes problems with commonmark output.
-        if (!cmark_isdigit(source[i + 1])) {
+        if (i + 1 == length || !cmark_isdigit(source[i + 1])) {
           renderer->last_breakable = last_nonspace;
         }
       }
@@ -149,6 +169,11 @@ static void S_out(cmark_renderer *renderer, cmark_node *node,
   }
 }
 
+static void S_out(cmark_renderer *renderer, cmark_node *node,
+                  const char *source, bool wrap, cmark_escaping escape) {
+  S_out_len(renderer, node, source, (bufsize_t)strlen(source), wrap, escape);
+}
+
 // Assumes no newlines, assumes ascii content:
 void cmark_render_ascii(cmark_renderer *renderer, const char *s) {
   int origsize = renderer->buffer->size;
@@ -161,33 +186,65 @@ void cmark_render_code_point(cmark_renderer *renderer, uint32_t c) {
   renderer->column += 1;
 }
 
-char *cmark_render(cmark_mem *mem, cmark_node *root, int options, int width,
-                   void (*outc)(cmark_renderer *, cmark_node *,
-                                cmark_escaping, int32_t,
-                                unsigned char),
-                   int (*render_node)(cmark_renderer *renderer,
-                                      cmark_node *node,
-                                      cmark_event_type ev_type, int options)) {
+void cmark_sink_drain(cmark_sink *sink, cmark_strbuf *buf, bufsize_t len,
+                      int *status) {
+  if (len <= 0)
+    return;
+  if (!*status)
+    *status = sink->write((const char *)buf->ptr, (size_t)len, sink->userdata);
+  cmark_strbuf_drop(buf, len);
+}
+
+int cmark_write_file(const char *data, size_t len, void *userdata) {
+  return fwrite(data, 1, len, (FILE *)userdata) == len ? 0 : -1;
+}
+
+// Pass on what the renderer can no longer change: 'cr' and 'out' look
+// back at the last two bytes, and wrapping may rewrite everything after
+// 'last_breakable', which has to stay above zero.
+static void S_drain(cmark_renderer *renderer, cmark_sink *sink, int *status) {
+  bufsize_t len = renderer->buffer->size - 2;
+
+  if (renderer->last_breakable > 0 && renderer->last_breakable - 1 < len)
+    len = renderer->last_breakable - 1;
+  if (len <= 0)
+    return;
+
+  cmark_sink_drain(sink, renderer->buffer, len, status);
+  if (renderer->last_breakable > 0)
+    renderer->last_breakable -= len;
+}
+
+static int S_render(cmark_strbuf *buf, cmark_mem *mem, cmark_node *root,
+                    int options, int width,
+                    void (*outc)(cmark_renderer *, cmark_node *,
+                                 cmark_escaping, int32_t, unsigned char),
+                    int (*render_node)(cmark_renderer *renderer,
+                                       cmark_node *node,
+                                       cmark_event_type ev_type, int options),
+                    cmark_sink *sink) {
   cmark_strbuf pref = CMARK_BUF_INIT(mem);
-  cmark_strbuf buf = CMARK_BUF_INIT(mem);
   cmark_node *cur;
   cmark_event_type ev_type;
-  char *result;
+  int status = 0;
   cmark_iter *iter = cmark_iter_new(root);
 
-  cmark_renderer renderer = {mem,   &buf, &pref, 0,           width,
+  cmark_renderer renderer = {mem,   buf,  &pref, 0,           width,
                              0,     0,    true,  true,        false,
                              false, outc, S_cr,  S_blankline, S_out,
-                             0};
+                             0,     S_out_len, NULL, NULL};
 
-  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+  while (!status && (ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
     cur = cmark_iter_get_node(iter);
+    S_track_escape_ext(&renderer, cur);
     if (!render_node(&renderer, cur, ev_type, options)) {
       // a false value causes us to skip processing
       // the node's contents.  this is used for
       // autolinks.
       cmark_iter_reset(iter, cur, CMARK_EVENT_EXIT);
     }
+    if (sink && cmark_sink_ready(sink, buf))
+      S_drain(&renderer, sink, &status);
   }
 
   // ensure final newline
@@ -195,11 +252,42 @@ char *cmark_render(cmark_mem *mem, cmark_node *root, int options, int width,
     cmark_strbuf_putc(renderer.buffer, '\n');
   }
 
-  result = (char *)cmark_strbuf_detach(renderer.buffer);
+  if (sink)
+    cmark_sink_drain(sink, buf, buf->size, &status);
 
   cmark_iter_free(iter);
   cmark_strbuf_free(renderer.prefix);
-  cmark_strbuf_free(renderer.buffer);
 
-  return result;
+  return status;
+}
+
+char *cmark_render(cmark_mem *mem, cmark_node *root, int options, int width,
+                   void (*outc)(cmark_renderer *, cmark_node *,
+                                cmark_escaping, int32_t,
+                                unsigned char),
+                   int (*render_node)(cmark_renderer *renderer,
+                                      cmark_node *node,
+                                      cmark_event_type ev_type, int options)) {
+  cmark_strbuf buf = CMARK_BUF_INIT(mem);
+
+  S_render(&buf, mem, root, options, width, outc, render_node, NULL);
+  return (char *)cmark_strbuf_detach(&buf);
+}
+
+int cmark_render_to_sink(cmark_mem *mem, cmark_node *root, int options,
+                         int width,
+                         void (*outc)(cmark_renderer *, cmark_node *,
+                                      cmark_escaping, int32_t,
+                                      unsigned char),
+                         int (*render_node)(cmark_renderer *renderer,
+                                            cmark_node *node,
+                                            cmark_event_type ev_type,
+                                            int options),
+                         cmark_sink *sink) {
+  cmark_strbuf buf = CMARK_BUF_INIT(mem);
+  int status;
+
+  status = S_render(&buf, mem, root, options, width, outc, render_node, sink);
+  cmark_strbuf_free(&buf);
+  return status;
 }
@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include "buffer.h"
 #include "chunk.h"
 
@@ -28,6 +29,14 @@ struct cmark_renderer {
   void (*blankline)(struct cmark_renderer *);
   void (*out)(struct cmark_renderer *, cmark_node *, const char *, bool, cmark_escaping);
   unsigned int footnote_ix;
+  // As 'out', for 'len' bytes that need not be NUL-terminated.
+  void (*out_len)(struct cmark_renderer *, cmark_node *, const char *,
+                  bufsize_t, bool, cmark_escaping);
+  // The node the render loop is on, and the extension whose
+  // commonmark_escape_func applies to it, so that output for it need
+  // not look through its ancestors.
+  cmark_node *escape_node;
+  cmark_syntax_extension *escape_ext;
 };
 
 typedef struct cmark_renderer cmark_renderer;
@@ -45,6 +54,14 @@ typedef struct cmark_html_renderer cmark_html_renderer;
 
 void cmark_render_ascii(cmark_renderer *renderer, const char *s);
 
+// As renderer->out; inlined so that the length of a string literal is
+// known at compile time.
+static CMARK_INLINE void cmark_render_out(cmark_renderer *renderer,
+                                          cmark_node *node, const char *s,
+                                          bool wrap, cmark_escaping escape) {
+  renderer->out_len(renderer, node, s, (bufsize_t)strlen(s), wrap, escape);
+}
+
 void cmark_render_code_point(cmark_renderer *renderer, uint32_t c);
 
 char *cmark_render(cmark_mem *mem, cmark_node *root, int options, int width,
@@ -55,6 +72,35 @@ char *cmark_render(cmark_mem *mem, cmark_node *root, int options, int width,
                                       cmark_node *node,
                                       cmark_event_type ev_type, int options));
 
+int cmark_render_to_sink(cmark_mem *mem, cmark_node *root, int options,
+                         int width,
+                         void (*outc)(cmark_renderer *, cmark_node *,
+                                      cmark_escaping, int32_t,
+                                      unsigned char),
+                         int (*render_node)(cmark_renderer *renderer,
+                                            cmark_node *node,
+                                            cmark_event_type ev_type,
+                                            int options),
+                         cmark_sink *sink);
+
+// Output is collected until there is at least this much to pass on,
+// unless the sink asks for another size.
+#define CMARK_SINK_DEFAULT_CHUNK_SIZE 8192
+
+// Whether 'buf' holds enough output to be passed on to 'sink'.
+static CMARK_INLINE bool cmark_sink_ready(const cmark_sink *sink,
+                                          const cmark_strbuf *buf) {
+  size_t chunk_size = sink->chunk_size ? sink->chunk_size
+                                       : CMARK_SINK_DEFAULT_CHUNK_SIZE;
+  return (size_t)buf->size >= chunk_size;
+}
+
+// Pass the first 'len' bytes of 'buf' on to 'sink' and drop them.  Once
+// a write has failed, '*status' keeps its result and nothing more is
+// written.
+void cmark_sink_drain(cmark_sink *sink, cmark_strbuf *buf, bufsize_t len,
+                      int *status);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,9 +13,12 @@ bufsize_t _scan_at(bufsize_t (*scanner)(const unsigned char *), cmark_chunk *c,
         } else {
 	  unsigned char lim = ptr[c->len];
 
-	  ptr[c->len] = '\0';
+	  // Chunks that are already terminated may be read-only.
+	  if (lim)
+	    ptr[c->len] = '\0';
 	  res = scanner(ptr + offset);
-	  ptr[c->len] = lim;
+	  if (lim)
+	    ptr[c->len] = lim;
         }
 
 	return res;
@@ -0,0 +1,560 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "cmark-gfm.h"
+#include "node.h"
+#include "buffer.h"
+#include "render.h"
+#include "syntax_extension.h"
+
+// Binary form of a node tree, in native byte order:
+//
+//   header      "CMKB", u32 version, u32 node, extension and type counts
+//   extensions  the name of each extension referred to by a node
+//   types       u16 type, u16 extension, type string: how each node type
+//               added by an extension was known when the tree was written
+//   nodes       in document order: u16 type, u16 extension (0 for none),
+//               u32 number of children, i32 start line and column, i32 end
+//               line and column, then what the type keeps in 'as' and the
+//               opaque data of the node's extension, if it has any
+//
+// Strings are a u32 length followed by the bytes and a NUL, so that the
+// loaded tree can point straight into the serialized data.
+
+#define SERIALIZE_MAGIC "CMKB"
+#define SERIALIZE_VERSION 1
+
+#define MAX_EXTENSIONS 64
+
+typedef struct {
+  cmark_syntax_extension *extensions[MAX_EXTENSIONS];
+  uint16_t n_extensions;
+  uint16_t types[MAX_EXTENSIONS];
+  uint16_t type_extensions[MAX_EXTENSIONS];
+  uint16_t n_types;
+} type_table;
+
+static bool S_is_core_type(uint16_t type) {
+  if ((type & CMARK_NODE_TYPE_MASK) == CMARK_NODE_TYPE_BLOCK)
+    return type >= CMARK_NODE_DOCUMENT && type <= CMARK_NODE_FOOTNOTE_DEFINITION;
+  if ((type & CMARK_NODE_TYPE_MASK) == CMARK_NODE_TYPE_INLINE)
+    return type >= CMARK_NODE_TEXT && type <= CMARK_NODE_FOOTNOTE_REFERENCE;
+  return false;
+}
+
+// The type string of a fresh node of 'type' made by 'extension', which
+// does not depend on what a particular node holds.
+static void S_type_string(cmark_mem *mem, uint16_t type,
+                          cmark_syntax_extension *extension,
+                          cmark_strbuf *out) {
+  cmark_node *node = cmark_node_new_with_mem_and_ext((cmark_node_type)type,
+                                                     mem, extension);
+  cmark_strbuf_puts(out, cmark_node_get_type_string(node));
+  cmark_node_free(node);
+}
+
+typedef struct {
+  cmark_strbuf buf;
+  cmark_sink sink;
+  int status;
+} writer;
+
+static void S_put_u16(writer *w, uint16_t v) {
+  cmark_strbuf_put(&w->buf, (const unsigned char *)&v, sizeof(v));
+}
+
+static void S_put_u32(writer *w, uint32_t v) {
+  cmark_strbuf_put(&w->buf, (const unsigned char *)&v, sizeof(v));
+}
+
+static void S_put_i32(writer *w, int32_t v) {
+  cmark_strbuf_put(&w->buf, (const unsigned char *)&v, sizeof(v));
+}
+
+static void S_put_bytes(writer *w, const unsigned char *data, bufsize_t len) {
+  S_put_u32(w, (uint32_t)len);
+  cmark_strbuf_put(&w->buf, data, len);
+  cmark_strbuf_putc(&w->buf, '\0');
+}
+
+static void S_put_chunk(writer *w, const cmark_chunk *c) {
+  S_put_bytes(w, c->data, c->len);
+}
+
+static int S_append(const char *data, size_t len, void *userdata) {
+  cmark_strbuf_put((cmark_strbuf *)userdata, (const unsigned char *)data,
+                   (bufsize_t)len);
+  return 0;
+}
+
+static int S_find_extension(type_table *table,
+                            cmark_syntax_extension *extension) {
+  uint16_t i;
+
+  for (i = 0; i < table->n_extensions; ++i)
+    if (table->extensions[i] == extension)
+      return i + 1;
+  if (table->n_extensions == MAX_EXTENSIONS)
+    return -1;
+  table->extensions[table->n_extensions++] = extension;
+  return table->n_extensions;
+}
+
+static bool S_add_type(type_table *table, uint16_t type, int extension) {
+  uint16_t i;
+
+  for (i = 0; i < table->n_types; ++i)
+    if (table->types[i] == type)
+      return true;
+  if (table->n_types == MAX_EXTENSIONS)
+    return false;
+  table->types[table->n_types] = type;
+  table->type_extensions[table->n_types++] = (uint16_t)extension;
+  return true;
+}
+
+static void S_put_node(writer *w, type_table *table, cmark_node *node) {
+  cmark_node *child;
+  uint32_t n_children = 0;
+  uint16_t extension = 0;
+  uint16_t i;
+
+  for (i = 0; i < table->n_extensions; ++i)
+    if (table->extensions[i] == node->extension)
+      extension = i + 1;
+  for (child = node->first_child; child; child = child->next)
+    ++n_children;
+
+  S_put_u16(w, node->type);
+  S_put_u16(w, extension);
+  S_put_u32(w, n_children);
+  S_put_i32(w, node->start_line);
+  S_put_i32(w, node->start_column);
+  S_put_i32(w, node->end_line);
+  S_put_i32(w, node->end_column);
+
+  switch (node->type) {
+  case CMARK_NODE_LIST:
+  case CMARK_NODE_ITEM:
+    cmark_strbuf_putc(&w->buf, (int)node->as.list.list_type);
+    cmark_strbuf_putc(&w->buf, (int)node->as.list.delimiter);
+    cmark_strbuf_putc(&w->buf, node->as.list.bullet_char);
+    cmark_strbuf_putc(&w->buf, node->as.list.tight);
+    cmark_strbuf_putc(&w->buf, node->as.list.checked);
+    S_put_i32(w, node->as.list.marker_offset);
+    S_put_i32(w, node->as.list.padding);
+    S_put_i32(w, node->as.list.start);
+    break;
+  case CMARK_NODE_CODE_BLOCK:
+    cmark_strbuf_putc(&w->buf, node->as.code.fence_length);
+    cmark_strbuf_putc(&w->buf, node->as.code.fence_offset);
+    cmark_strbuf_putc(&w->buf, node->as.code.fence_char);
+    cmark_strbuf_putc(&w->buf, (uint8_t)node->as.code.fenced);
+    S_put_chunk(w, &node->as.code.info);
+    S_put_chunk(w, &node->as.code.literal);
+    break;
+  case CMARK_NODE_HEADING:
+    cmark_strbuf_putc(&w->buf, node->as.heading.setext);
+    S_put_i32(w, node->as.heading.level);
+    break;
+  case CMARK_NODE_TEXT:
+  case CMARK_NODE_CODE:
+  case CMARK_NODE_HTML_INLINE:
+  case CMARK_NODE_HTML_BLOCK:
+  case CMARK_NODE_FOOTNOTE_REFERENCE:
+  case CMARK_NODE_FOOTNOTE_DEFINITION:
+    S_put_chunk(w, &node->as.literal);
+    break;
+  case CMARK_NODE_LINK:
+  case CMARK_NODE_IMAGE:
+    S_put_chunk(w, &node->as.link.url);
+    S_put_chunk(w, &node->as.link.title);
+    break;
+  case CMARK_NODE_CUSTOM_BLOCK:
+  case CMARK_NODE_CUSTOM_INLINE:
+    S_put_chunk(w, &node->as.custom.on_enter);
+    S_put_chunk(w, &node->as.custom.on_exit);
+    break;
+  default:
+    break;
+  }
+
+  if (node->extension) {
+    cmark_strbuf opaque = CMARK_BUF_INIT(w->buf.mem);
+
+    if (node->extension->opaque_serialize_func)
+      node->extension->opaque_serialize_func(node->extension, node, S_append,
+                                             &opaque);
+    S_put_bytes(w, opaque.ptr, opaque.size);
+    cmark_strbuf_free(&opaque);
+  }
+}
+
+int cmark_node_serialize(cmark_node *root, cmark_write_func write,
+                         void *userdata) {
+  cmark_mem *mem = cmark_node_mem(root);
+  writer w = {CMARK_BUF_INIT(mem), {write, userdata, 0}, 0};
+  cmark_strbuf type_string = CMARK_BUF_INIT(mem);
+  type_table table;
+  cmark_event_type ev_type;
+  cmark_node *cur;
+  uint32_t n_nodes = 0;
+  cmark_iter *iter = cmark_iter_new(root);
+  uint16_t i;
+  int extension;
+
+  table.n_extensions = table.n_types = 0;
+  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    if (ev_type != CMARK_EVENT_ENTER)
+      continue;
+    cur = cmark_iter_get_node(iter);
+    ++n_nodes;
+    if (!cur->extension) {
+      if (S_is_core_type(cur->type))
+        continue;
+      extension = -1;
+    } else {
+      extension = S_find_extension(&table, cur->extension);
+    }
+    if (extension < 0 ||
+        (!S_is_core_type(cur->type) && !S_add_type(&table, cur->type, extension))) {
+      cmark_iter_free(iter);
+      return -1;
+    }
+  }
+
+  cmark_strbuf_put(&w.buf, (const unsigned char *)SERIALIZE_MAGIC, 4);
+  S_put_u32(&w, SERIALIZE_VERSION);
+  S_put_u32(&w, n_nodes);
+  S_put_u32(&w, table.n_extensions);
+  S_put_u32(&w, table.n_types);
+
+  for (i = 0; i < table.n_extensions; ++i)
+    S_put_bytes(&w, (const unsigned char *)table.extensions[i]->name,
+                (bufsize_t)strlen(table.extensions[i]->name));
+
+  for (i = 0; i < table.n_types; ++i) {
+    S_put_u16(&w, table.types[i]);
+    S_put_u16(&w, table.type_extensions[i]);
+    cmark_strbuf_clear(&type_string);
+    S_type_string(mem, table.types[i],
+                  table.extensions[table.type_extensions[i] - 1],
+                  &type_string);
+    S_put_bytes(&w, type_string.ptr, type_string.size);
+  }
+
+  cmark_iter_free(iter);
+  iter = cmark_iter_new(root);
+  while (!w.status && (ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+    if (ev_type != CMARK_EVENT_ENTER)
+      continue;
+    S_put_node(&w, &table, cmark_iter_get_node(iter));
+    if (cmark_sink_ready(&w.sink, &w.buf))
+      cmark_sink_drain(&w.sink, &w.buf, w.buf.size, &w.status);
+  }
+  cmark_sink_drain(&w.sink, &w.buf, w.buf.size, &w.status);
+
+  cmark_iter_free(iter);
+  cmark_strbuf_free(&type_string);
+  cmark_strbuf_free(&w.buf);
+
+  return w.status;
+}
+
+typedef struct {
+  const unsigned char *p;
+  const unsigned char *end;
+} reader;
+
+static bool S_get(reader *r, void *out, size_t n) {
+  if ((size_t)(r->end - r->p) < n)
+    return false;
+  memcpy(out, r->p, n);
+  r->p += n;
+  return true;
+}
+
+static bool S_get_u8(reader *r, uint8_t *v) { return S_get(r, v, 1); }
+
+static bool S_get_u16(reader *r, uint16_t *v) { return S_get(r, v, 2); }
+
+static bool S_get_u32(reader *r, uint32_t *v) { return S_get(r, v, 4); }
+
+static bool S_get_i32(reader *r, int32_t *v) { return S_get(r, v, 4); }
+
+static bool S_get_bytes(reader *r, const unsigned char **data, uint32_t *len) {
+  if (!S_get_u32(r, len) || *len >= (uint32_t)(r->end - r->p) ||
+      *len > (uint32_t)INT32_MAX || r->p[*len] != '\0')
+    return false;
+  *data = r->p;
+  r->p += *len + 1;
+  return true;
+}
+
+// Point 'c' at a string in the serialized data, without copying it.
+static bool S_get_chunk(reader *r, cmark_chunk *c) {
+  const unsigned char *data;
+  uint32_t len;
+
+  if (!S_get_bytes(r, &data, &len))
+    return false;
+  c->data = (unsigned char *)data;
+  c->len = (bufsize_t)len;
+  c->alloc = 0;
+  return true;
+}
+
+typedef struct {
+  cmark_syntax_extension *extensions[MAX_EXTENSIONS];
+  uint32_t n_extensions;
+  // Saved and current value of each type added by an extension.
+  uint16_t types[MAX_EXTENSIONS];
+  uint16_t current_types[MAX_EXTENSIONS];
+  uint32_t n_types;
+} load_table;
+
+static bool S_type_matches(cmark_mem *mem, uint16_t type,
+                           cmark_syntax_extension *extension,
+                           const unsigned char *type_string) {
+  cmark_strbuf buf = CMARK_BUF_INIT(mem);
+  bool matches;
+
+  S_type_string(mem, type, extension, &buf);
+  matches = strcmp((const char *)buf.ptr, (const char *)type_string) == 0;
+  cmark_strbuf_free(&buf);
+  return matches;
+}
+
+// Find the type that 'extension' now uses for 'type_string', trying the
+// saved value first: it only changes if extensions were registered in
+// another order.  Returns 0 if there is none.
+static uint16_t S_resolve_type(cmark_mem *mem, uint16_t type,
+                               cmark_syntax_extension *extension,
+                               const unsigned char *type_string) {
+  uint16_t first, last, candidate;
+
+  if ((type & CMARK_NODE_TYPE_MASK) == CMARK_NODE_TYPE_BLOCK) {
+    first = CMARK_NODE_FOOTNOTE_DEFINITION + 1;
+    last = CMARK_NODE_LAST_BLOCK;
+  } else if ((type & CMARK_NODE_TYPE_MASK) == CMARK_NODE_TYPE_INLINE) {
+    first = CMARK_NODE_FOOTNOTE_REFERENCE + 1;
+    last = CMARK_NODE_LAST_INLINE;
+  } else {
+    return 0;
+  }
+
+  if (type >= first && type <= last &&
+      S_type_matches(mem, type, extension, type_string))
+    return type;
+  for (candidate = first; candidate <= last; ++candidate)
+    if (candidate != type &&
+        S_type_matches(mem, candidate, extension, type_string))
+      return candidate;
+  return 0;
+}
+
+static bool S_load_tables(reader *r, cmark_mem *mem, load_table *table) {
+  const unsigned char *data;
+  uint32_t len, i, n_extensions, n_types;
+  uint16_t type, extension;
+
+  if (!S_get_u32(r, &n_extensions) || !S_get_u32(r, &n_types) ||
+      n_extensions > MAX_EXTENSIONS || n_types > MAX_EXTENSIONS)
+    return false;
+
+  table->n_extensions = n_extensions;
+  for (i = 0; i < n_extensions; ++i) {
+    if (!S_get_bytes(r, &data, &len))
+      return false;
+    table->extensions[i] = cmark_find_syntax_extension((const char *)data);
+    if (!table->extensions[i])
+      return false;
+  }
+
+  table->n_types = n_types;
+  for (i = 0; i < n_types; ++i) {
+    if (!S_get_u16(r, &type) || !S_get_u16(r, &extension) ||
+        !S_get_bytes(r, &data, &len) || extension == 0 ||
+        extension > n_extensions)
+      return false;
+    table->types[i] = type;
+    table->current_types[i] =
+        S_resolve_type(mem, type, table->extensions[extension - 1], data);
+    if (!table->current_types[i])
+      return false;
+  }
+
+  return true;
+}
+
+static bool S_load_payload(reader *r, cmark_node *node) {
+  uint8_t list_type, delimiter, bullet_char, tight, checked;
+  uint8_t fence_length, fence_offset, fence_char, fenced, setext;
+
+  switch (node->type) {
+  case CMARK_NODE_LIST:
+  case CMARK_NODE_ITEM:
+    if (!S_get_u8(r, &list_type) || !S_get_u8(r, &delimiter) ||
+        !S_get_u8(r, &bullet_char) || !S_get_u8(r, &tight) ||
+        !S_get_u8(r, &checked) ||
+        !S_get_i32(r, &node->as.list.marker_offset) ||
+        !S_get_i32(r, &node->as.list.padding) ||
+        !S_get_i32(r, &node->as.list.start))
+      return false;
+    node->as.list.list_type = (cmark_list_type)list_type;
+    node->as.list.delimiter = (cmark_delim_type)delimiter;
+    node->as.list.bullet_char = bullet_char;
+    node->as.list.tight = tight != 0;
+    node->as.list.checked = checked != 0;
+    return true;
+  case CMARK_NODE_CODE_BLOCK:
+    if (!S_get_u8(r, &fence_length) || !S_get_u8(r, &fence_offset) ||
+        !S_get_u8(r, &fence_char) || !S_get_u8(r, &fenced))
+      return false;
+    node->as.code.fence_length = fence_length;
+    node->as.code.fence_offset = fence_offset;
+    node->as.code.fence_char = fence_char;
+    node->as.code.fenced = (int8_t)fenced;
+    return S_get_chunk(r, &node->as.code.info) &&
+           S_get_chunk(r, &node->as.code.literal);
+  case CMARK_NODE_HEADING:
+    if (!S_get_u8(r, &setext) || !S_get_i32(r, &node->as.heading.level) ||
+        node->as.heading.level < 1 || node->as.heading.level > 6)
+      return false;
+    node->as.heading.setext = setext != 0;
+    return true;
+  case CMARK_NODE_TEXT:
+  case CMARK_NODE_CODE:
+  case CMARK_NODE_HTML_INLINE:
+  case CMARK_NODE_HTML_BLOCK:
+  case CMARK_NODE_FOOTNOTE_REFERENCE:
+  case CMARK_NODE_FOOTNOTE_DEFINITION:
+    return S_get_chunk(r, &node->as.literal);
+  case CMARK_NODE_LINK:
+  case CMARK_NODE_IMAGE:
+    return S_get_chunk(r, &node->as.link.url) &&
+           S_get_chunk(r, &node->as.link.title);
+  case CMARK_NODE_CUSTOM_BLOCK:
+  case CMARK_NODE_CUSTOM_INLINE:
+    return S_get_chunk(r, &node->as.custom.on_enter) &&
+           S_get_chunk(r, &node->as.custom.on_exit);
+  default:
+    return true;
+  }
+}
+
+static cmark_node *S_load_node(reader *r, cmark_mem *mem, load_table *table,
+                               uint32_t *n_children) {
+  cmark_syntax_extension *extension = NULL;
+  cmark_node *node;
+  const unsigned char *opaque;
+  uint32_t opaque_len, i;
+  uint16_t type, ext;
+
+  if (!S_get_u16(r, &type) || !S_get_u16(r, &ext) ||
+      !S_get_u32(r, n_children) || ext > table->n_extensions)
+    return NULL;
+  if (ext)
+    extension = table->extensions[ext - 1];
+
+  if (!S_is_core_type(type)) {
+    for (i = 0; i < table->n_types && table->types[i] != type; ++i)
+      ;
+    if (i == table->n_types || !extension)
+      return NULL;
+    type = table->current_types[i];
+  }
+
+  node = cmark_node_new_with_mem_and_ext((cmark_node_type)type, mem, extension);
+  if (!S_get_i32(r, &node->start_line) || !S_get_i32(r, &node->start_column) ||
+      !S_get_i32(r, &node->end_line) || !S_get_i32(r, &node->end_column) ||
+      !S_load_payload(r, node) ||
+      (extension && !S_get_bytes(r, &opaque, &opaque_len)) ||
+      (extension && extension->opaque_deserialize_func && opaque_len &&
+       extension->opaque_deserialize_func(extension, mem, node, opaque,
+                                          opaque_len) != 0)) {
+    cmark_node_free(node);
+    return NULL;
+  }
+
+  return node;
+}
+
+typedef struct {
+  cmark_node *node;
+  uint32_t remaining;
+} load_frame;
+
+cmark_node *cmark_node_deserialize_with_mem(const void *data, size_t len,
+                                            cmark_mem *mem) {
+  reader r = {(const unsigned char *)data, (const unsigned char *)data + len};
+  load_table table;
+  load_frame *stack = NULL;
+  size_t depth = 0, stack_size = 0;
+  cmark_node *root = NULL, *node, *parent;
+  uint32_t version, n_nodes, loaded = 0, n_children;
+  char magic[4];
+
+  if (!S_get(&r, magic, 4) || memcmp(magic, SERIALIZE_MAGIC, 4) != 0 ||
+      !S_get_u32(&r, &version) || version != SERIALIZE_VERSION ||
+      !S_get_u32(&r, &n_nodes) || !S_load_tables(&r, mem, &table))
+    return NULL;
+
+  do {
+    node = S_load_node(&r, mem, &table, &n_children);
+    if (!node)
+      goto fail;
+    ++loaded;
+
+    if (!root) {
+      root = node;
+    } else {
+      parent = stack[depth - 1].node;
+      if (!cmark_node_can_contain_type(parent, (cmark_node_type)node->type)) {
+        cmark_node_free(node);
+        goto fail;
+      }
+      node->parent = parent;
+      node->prev = parent->last_child;
+      if (parent->last_child)
+        parent->last_child->next = node;
+      else
+        parent->first_child = node;
+      parent->last_child = node;
+      --stack[depth - 1].remaining;
+    }
+
+    if (n_children) {
+      if (depth == stack_size) {
+        stack_size = stack_size ? stack_size * 2 : 32;
+        stack = (load_frame *)mem->realloc(stack,
+                                           stack_size * sizeof(load_frame));
+      }
+      stack[depth].node = node;
+      stack[depth].remaining = n_children;
+      ++depth;
+    }
+    while (depth && !stack[depth - 1].remaining)
+      --depth;
+  } while (depth && loaded < n_nodes);
+
+  if (depth || loaded != n_nodes || r.p != r.end)
+    goto fail;
+
+  mem->free(stack);
+  return root;
+
+fail:
+  mem->free(stack);
+  if (root)
+    cmark_node_free(root);
+  return NULL;
+}
+
+cmark_node *cmark_node_deserialize(const void *data, size_t len) {
+  extern cmark_mem CMARK_DEFAULT_MEM_ALLOCATOR;
+  return cmark_node_deserialize_with_mem(data, len,
+                                         &CMARK_DEFAULT_MEM_ALLOCATOR);
+}
@@ -0,0 +1,622 @@
+#include <string.h>
+
+#include "simd.h"
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CMARK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(HAVE_AVX2_TARGET) && defined(CMARK_SSE2)
+#define CMARK_AVX2 1
+#define CMARK_SSSE3 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define CMARK_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(CMARK_SSE2) || defined(CMARK_AVX2))
+#include <intrin.h>
+static CMARK_INLINE unsigned S_ctz(unsigned x) {
+  unsigned long i;
+  _BitScanForward(&i, x);
+  return (unsigned)i;
+}
+#elif defined(CMARK_SSE2) || defined(CMARK_AVX2)
+#define S_ctz(x) ((unsigned)__builtin_ctz(x))
+#endif
+
+// Each search picks its implementation for the running CPU the first
+// time it is used.  Parsers on several threads may get there together,
+// so the choice is made under a once-only guard.
+#if defined(HAVE_PTHREAD)
+#include <pthread.h>
+
+typedef pthread_once_t simd_once;
+#define SIMD_ONCE_INIT PTHREAD_ONCE_INIT
+
+static void S_once(simd_once *once, void (*init)(void)) {
+  pthread_once(once, init);
+}
+
+#elif defined(HAVE_WIN32_THREADS)
+#include <windows.h>
+
+typedef INIT_ONCE simd_once;
+#define SIMD_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+static BOOL CALLBACK S_once_thunk(PINIT_ONCE once, PVOID init, PVOID *ctx) {
+  (void)once;
+  (void)ctx;
+  (*(void (**)(void))init)();
+  return TRUE;
+}
+
+static void S_once(simd_once *once, void (*init)(void)) {
+  InitOnceExecuteOnce(once, S_once_thunk, (PVOID)&init, NULL);
+}
+
+#else
+// Without threads there is nothing to race with.
+typedef int simd_once;
+#define SIMD_ONCE_INIT 0
+
+static void S_once(simd_once *once, void (*init)(void)) {
+  if (!*once) {
+    init();
+    *once = 1;
+  }
+}
+#endif
+
+typedef const unsigned char *(*find3_func)(const unsigned char *,
+                                           const unsigned char *,
+                                           unsigned char, unsigned char,
+                                           unsigned char);
+
+static const unsigned char *find3_scalar(const unsigned char *p,
+                                         const unsigned char *end,
+                                         unsigned char a, unsigned char b,
+                                         unsigned char c) {
+  for (; p < end; ++p) {
+    if (*p == a || *p == b || *p == c)
+      return p;
+  }
+  return end;
+}
+
+#ifdef CMARK_SSE2
+static const unsigned char *find3_sse2(const unsigned char *p,
+                                       const unsigned char *end,
+                                       unsigned char a, unsigned char b,
+                                       unsigned char c) {
+  const __m128i va = _mm_set1_epi8((char)a);
+  const __m128i vb = _mm_set1_epi8((char)b);
+  const __m128i vc = _mm_set1_epi8((char)c);
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+        _mm_cmpeq_epi8(v, vc));
+    unsigned mask = (unsigned)_mm_movemask_epi8(m);
+    if (mask)
+      return p + S_ctz(mask);
+    p += 16;
+  }
+
+  return find3_scalar(p, end, a, b, c);
+}
+#endif
+
+#ifdef CMARK_AVX2
+__attribute__((target("avx2")))
+static const unsigned char *find3_avx2(const unsigned char *p,
+                                       const unsigned char *end,
+                                       unsigned char a, unsigned char b,
+                                       unsigned char c) {
+  const __m256i va = _mm256_set1_epi8((char)a);
+  const __m256i vb = _mm256_set1_epi8((char)b);
+  const __m256i vc = _mm256_set1_epi8((char)c);
+
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i m = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+        _mm256_cmpeq_epi8(v, vc));
+    unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+    if (mask)
+      return p + S_ctz(mask);
+    p += 32;
+  }
+
+  return find3_sse2(p, end, a, b, c);
+}
+#endif
+
+#ifdef CMARK_NEON
+static const unsigned char *find3_neon(const unsigned char *p,
+                                       const unsigned char *end,
+                                       unsigned char a, unsigned char b,
+                                       unsigned char c) {
+  const uint8x16_t va = vdupq_n_u8(a);
+  const uint8x16_t vb = vdupq_n_u8(b);
+  const uint8x16_t vc = vdupq_n_u8(c);
+
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)),
+                            vceqq_u8(v, vc));
+    if (vmaxvq_u8(m))
+      return find3_scalar(p, p + 16, a, b, c);
+    p += 16;
+  }
+
+  return find3_scalar(p, end, a, b, c);
+}
+#endif
+
+static find3_func S_select_find3(void) {
+#ifdef CMARK_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return find3_avx2;
+#endif
+#if defined(CMARK_SSE2)
+  return find3_sse2;
+#elif defined(CMARK_NEON)
+  return find3_neon;
+#else
+  return find3_scalar;
+#endif
+}
+
+static find3_func find3_impl;
+static simd_once find3_once = SIMD_ONCE_INIT;
+
+static void S_init_find3(void) { find3_impl = S_select_find3(); }
+
+const unsigned char *cmark_simd_find3(const unsigned char *p,
+                                      const unsigned char *end,
+                                      unsigned char a, unsigned char b,
+                                      unsigned char c) {
+  S_once(&find3_once, S_init_find3);
+  return find3_impl(p, end, a, b, c);
+}
+
+void cmark_simd_byteset_init(cmark_simd_byteset *set, const int8_t *member) {
+  unsigned short rows[16] = {0};
+  unsigned short classes[8];
+  int nclasses = 0, i, k;
+
+  memset(set, 0, sizeof(*set));
+  set->nibbles = true;
+
+  for (i = 0; i < 256; ++i) {
+    if (member[i]) {
+      set->member[i] = 1;
+      rows[i >> 4] |= (unsigned short)(1 << (i & 0x0F));
+    }
+  }
+
+  // High nibbles whose rows hold the same low nibbles share a bit, so
+  // that 'b' is a member exactly when lo[b & 15] & hi[b >> 4] is non-zero.
+  // Sets of ASCII bytes never need more than the 8 bits available.
+  for (i = 0; i < 16; ++i) {
+    if (!rows[i])
+      continue;
+    for (k = 0; k < nclasses && classes[k] != rows[i]; ++k)
+      ;
+    if (k == nclasses) {
+      if (nclasses == 8) {
+        set->nibbles = false;
+        return;
+      }
+      classes[nclasses++] = rows[i];
+    }
+    set->hi[i] = (unsigned char)(1 << k);
+  }
+
+  for (k = 0; k < nclasses; ++k) {
+    for (i = 0; i < 16; ++i) {
+      if (classes[k] & (1 << i))
+        set->lo[i] |= (unsigned char)(1 << k);
+    }
+  }
+}
+
+typedef const unsigned char *(*find_set_func)(const unsigned char *,
+                                              const unsigned char *,
+                                              const cmark_simd_byteset *);
+
+static const unsigned char *find_set_scalar(const unsigned char *p,
+                                            const unsigned char *end,
+                                            const cmark_simd_byteset *set) {
+  for (; p < end; ++p) {
+    if (set->member[*p])
+      return p;
+  }
+  return end;
+}
+
+#ifdef CMARK_SSSE3
+__attribute__((target("ssse3")))
+static const unsigned char *find_set_ssse3(const unsigned char *p,
+                                           const unsigned char *end,
+                                           const cmark_simd_byteset *set) {
+  const __m128i lo = _mm_loadu_si128((const __m128i *)set->lo);
+  const __m128i hi = _mm_loadu_si128((const __m128i *)set->hi);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i zero = _mm_setzero_si128();
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(v, nibble));
+    __m128i h = _mm_shuffle_epi8(
+        hi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i m = _mm_cmpeq_epi8(_mm_and_si128(l, h), zero);
+    unsigned mask = (unsigned)_mm_movemask_epi8(m) ^ 0xFFFFu;
+    if (mask)
+      return p + S_ctz(mask);
+    p += 16;
+  }
+
+  return find_set_scalar(p, end, set);
+}
+#endif
+
+#ifdef CMARK_AVX2
+__attribute__((target("avx2")))
+static const unsigned char *find_set_avx2(const unsigned char *p,
+                                          const unsigned char *end,
+                                          const cmark_simd_byteset *set) {
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)set->lo));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)set->hi));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(v, nibble));
+    __m256i h = _mm256_shuffle_epi8(
+        hi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    __m256i m = _mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero);
+    unsigned mask = ~(unsigned)_mm256_movemask_epi8(m);
+    if (mask)
+      return p + S_ctz(mask);
+    p += 32;
+  }
+
+  return find_set_ssse3(p, end, set);
+}
+#endif
+
+#ifdef CMARK_NEON
+static const unsigned char *find_set_neon(const unsigned char *p,
+                                          const unsigned char *end,
+                                          const cmark_simd_byteset *set) {
+  const uint8x16_t lo = vld1q_u8(set->lo);
+  const uint8x16_t hi = vld1q_u8(set->hi);
+  const uint8x16_t nibble = vdupq_n_u8(0x0F);
+
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    uint8x16_t m = vtstq_u8(vqtbl1q_u8(lo, vandq_u8(v, nibble)),
+                            vqtbl1q_u8(hi, vshrq_n_u8(v, 4)));
+    if (vmaxvq_u8(m))
+      return find_set_scalar(p, p + 16, set);
+    p += 16;
+  }
+
+  return find_set_scalar(p, end, set);
+}
+#endif
+
+static find_set_func S_select_find_set(void) {
+#ifdef CMARK_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return find_set_avx2;
+#endif
+#ifdef CMARK_SSSE3
+  if (__builtin_cpu_supports("ssse3"))
+    return find_set_ssse3;
+#endif
+#if defined(CMARK_NEON)
+  return find_set_neon;
+#else
+  return find_set_scalar;
+#endif
+}
+
+static find_set_func find_set_impl;
+static simd_once find_set_once = SIMD_ONCE_INIT;
+
+static void S_init_find_set(void) { find_set_impl = S_select_find_set(); }
+
+const unsigned char *cmark_simd_find_set(const unsigned char *p,
+                                         const unsigned char *end,
+                                         const cmark_simd_byteset *set) {
+  if (!set->nibbles)
+    return find_set_scalar(p, end, set);
+  S_once(&find_set_once, S_init_find_set);
+  return find_set_impl(p, end, set);
+}
+
+// UTF-8 validation after Keiser and Lemire, "Validating UTF-8 in less
+// than one instruction per byte": three nibble lookups classify every
+// pair of adjacent bytes, and a fourth check catches missing or extra
+// continuation bytes after three- and four-byte leads.
+#define UTF8_TOO_SHORT (1 << 0)
+#define UTF8_TOO_LONG (1 << 1)
+#define UTF8_OVERLONG_3 (1 << 2)
+#define UTF8_TOO_LARGE (1 << 3)
+#define UTF8_SURROGATE (1 << 4)
+#define UTF8_OVERLONG_2 (1 << 5)
+#define UTF8_TOO_LARGE_1000 (1 << 6)
+#define UTF8_OVERLONG_4 (1 << 6)
+#define UTF8_TWO_CONTS (1 << 7)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#if defined(CMARK_SSSE3)
+// Indexed by the high nibble of the first byte of a pair.
+static const unsigned char UTF8_BYTE_1_HIGH[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4};
+
+// Indexed by the low nibble of the first byte of a pair.
+static const unsigned char UTF8_BYTE_1_LOW[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000};
+
+// Indexed by the high nibble of the second byte of a pair.
+static const unsigned char UTF8_BYTE_2_HIGH[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT};
+#endif
+
+typedef const unsigned char *(*utf8_func)(const unsigned char *,
+                                          const unsigned char *);
+
+// Given that the characters in ['start', 'p') are valid, except perhaps
+// for the last one, which may continue past 'p', returns the end of the
+// last character that is complete.
+static const unsigned char *S_utf8_boundary(const unsigned char *start,
+                                            const unsigned char *p) {
+  int i;
+
+  for (i = 1; i <= 3 && p - i >= start; ++i) {
+    unsigned char c = p[-i];
+    if (c < 0x80)
+      break;
+    if (c >= 0xC0)
+      return (c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2) > i ? p - i : p;
+  }
+  return p;
+}
+
+// Skips ASCII without NUL bytes, eight bytes at a time.
+static const unsigned char *utf8_scalar(const unsigned char *p,
+                                        const unsigned char *end) {
+  const uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+  uint64_t w;
+
+  while (end - p >= 8) {
+    memcpy(&w, p, 8);
+    if ((w & highs) || ((w - ones) & ~w & highs))
+      break;
+    p += 8;
+  }
+  return p;
+}
+
+#ifdef CMARK_SSE2
+// Skips ASCII without NUL bytes, for CPUs without byte shuffles.
+static const unsigned char *utf8_sse2(const unsigned char *p,
+                                      const unsigned char *end) {
+  const __m128i zero = _mm_setzero_si128();
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero))))
+      break;
+    p += 16;
+  }
+  return utf8_scalar(p, end);
+}
+#endif
+
+#ifdef CMARK_SSSE3
+__attribute__((target("ssse3")))
+static const unsigned char *utf8_ssse3(const unsigned char *p,
+                                       const unsigned char *end) {
+  const unsigned char *start = p;
+  const __m128i byte_1_high =
+      _mm_loadu_si128((const __m128i *)UTF8_BYTE_1_HIGH);
+  const __m128i byte_1_low = _mm_loadu_si128((const __m128i *)UTF8_BYTE_1_LOW);
+  const __m128i byte_2_high =
+      _mm_loadu_si128((const __m128i *)UTF8_BYTE_2_HIGH);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i third = _mm_set1_epi8((char)(0xE0 - 0x80));
+  const __m128i fourth = _mm_set1_epi8((char)(0xF0 - 0x80));
+  const __m128i high = _mm_set1_epi8((char)0x80);
+  // Bytes that would still need continuation bytes at the end of a block.
+  const __m128i incomplete_max =
+      _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m128i prev = zero, incomplete = zero;
+
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i err = _mm_cmpeq_epi8(v, zero);
+
+    if (!_mm_movemask_epi8(v)) {
+      err = _mm_or_si128(err, incomplete);
+      incomplete = zero;
+    } else {
+      __m128i prev1 = _mm_alignr_epi8(v, prev, 15);
+      __m128i prev2 = _mm_alignr_epi8(v, prev, 14);
+      __m128i prev3 = _mm_alignr_epi8(v, prev, 13);
+      __m128i special = _mm_and_si128(
+          _mm_and_si128(
+              _mm_shuffle_epi8(byte_1_high, _mm_and_si128(
+                                                _mm_srli_epi16(prev1, 4),
+                                                nibble)),
+              _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+          _mm_shuffle_epi8(byte_2_high,
+                           _mm_and_si128(_mm_srli_epi16(v, 4), nibble)));
+      __m128i must_continue =
+          _mm_and_si128(_mm_or_si128(_mm_subs_epu8(prev2, third),
+                                     _mm_subs_epu8(prev3, fourth)),
+                        high);
+      err = _mm_or_si128(err, _mm_xor_si128(must_continue, special));
+      incomplete = _mm_subs_epu8(v, incomplete_max);
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(err, zero)) != 0xFFFF)
+      break;
+    prev = v;
+    p += 16;
+  }
+
+  return S_utf8_boundary(start, p);
+}
+#endif
+
+#ifdef CMARK_AVX2
+__attribute__((target("avx2")))
+static const unsigned char *utf8_avx2(const unsigned char *p,
+                                      const unsigned char *end) {
+  const unsigned char *start = p;
+  const __m256i byte_1_high = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)UTF8_BYTE_1_HIGH));
+  const __m256i byte_1_low = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)UTF8_BYTE_1_LOW));
+  const __m256i byte_2_high = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128((const __m128i *)UTF8_BYTE_2_HIGH));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i third = _mm256_set1_epi8((char)(0xE0 - 0x80));
+  const __m256i fourth = _mm256_set1_epi8((char)(0xF0 - 0x80));
+  const __m256i high = _mm256_set1_epi8((char)0x80);
+  const __m256i incomplete_max = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1),
+      (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m256i prev = zero, incomplete = zero;
+
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i err = _mm256_cmpeq_epi8(v, zero);
+
+    if (!_mm256_movemask_epi8(v)) {
+      err = _mm256_or_si256(err, incomplete);
+      incomplete = zero;
+    } else {
+      // The last bytes of 'prev' followed by the first of 'v'.
+      __m256i shifted = _mm256_permute2x128_si256(prev, v, 0x21);
+      __m256i prev1 = _mm256_alignr_epi8(v, shifted, 15);
+      __m256i prev2 = _mm256_alignr_epi8(v, shifted, 14);
+      __m256i prev3 = _mm256_alignr_epi8(v, shifted, 13);
+      __m256i special = _mm256_and_si256(
+          _mm256_and_si256(
+              _mm256_shuffle_epi8(byte_1_high,
+                                  _mm256_and_si256(_mm256_srli_epi16(prev1, 4),
+                                                   nibble)),
+              _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+          _mm256_shuffle_epi8(byte_2_high,
+                              _mm256_and_si256(_mm256_srli_epi16(v, 4),
+                                               nibble)));
+      __m256i must_continue = _mm256_and_si256(
+          _mm256_or_si256(_mm256_subs_epu8(prev2, third),
+                          _mm256_subs_epu8(prev3, fourth)),
+          high);
+      err = _mm256_or_si256(err, _mm256_xor_si256(must_continue, special));
+      incomplete = _mm256_subs_epu8(v, incomplete_max);
+    }
+
+    if (!_mm256_testz_si256(err, err))
+      break;
+    prev = v;
+    p += 32;
+  }
+
+  return S_utf8_boundary(start, p);
+}
+#endif
+
+#ifdef CMARK_NEON
+// Skips ASCII without NUL bytes.
+static const unsigned char *utf8_neon(const unsigned char *p,
+                                      const unsigned char *end) {
+  while (end - p >= 16) {
+    uint8x16_t v = vld1q_u8(p);
+    if (vmaxvq_u8(v) >= 0x80 || vminvq_u8(v) == 0)
+      break;
+    p += 16;
+  }
+  return utf8_scalar(p, end);
+}
+#endif
+
+static utf8_func S_select_utf8(void) {
+#ifdef CMARK_AVX2
+  if (__builtin_cpu_supports("avx2"))
+    return utf8_avx2;
+#endif
+#ifdef CMARK_SSSE3
+  if (__builtin_cpu_supports("ssse3"))
+    return utf8_ssse3;
+#endif
+#if defined(CMARK_SSE2)
+  return utf8_sse2;
+#elif defined(CMARK_NEON)
+  return utf8_neon;
+#else
+  return utf8_scalar;
+#endif
+}
+
+static utf8_func utf8_impl;
+static simd_once utf8_once = SIMD_ONCE_INIT;
+
+static void S_init_utf8(void) { utf8_impl = S_select_utf8(); }
+
+const unsigned char *cmark_simd_skip_valid_utf8(const unsigned char *p,
+                                                const unsigned char *end) {
+  S_once(&utf8_once, S_init_utf8);
+  return utf8_impl(p, end);
+}
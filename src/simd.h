@@ -0,0 +1,59 @@
+#ifndef CMARK_SIMD_H
+#define CMARK_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Returns a pointer to the first byte in ['p', 'end') that is equal to
+ * 'a', 'b' or 'c', or 'end' if there is none.  Scans 16 or 32 bytes at a
+ * time, using the widest vector unit the running CPU supports.
+ */
+const unsigned char *cmark_simd_find3(const unsigned char *p,
+                                      const unsigned char *end,
+                                      unsigned char a, unsigned char b,
+                                      unsigned char c);
+
+/** A set of bytes to search for with cmark_simd_find_set().  Besides
+ * the plain membership table, the set is split into a pair of 16-entry
+ * tables indexed by the low and high nibble of a byte, which lets a
+ * vector unit classify 16 or 32 bytes with two shuffles.
+ */
+typedef struct cmark_simd_byteset {
+  unsigned char member[256];
+  unsigned char lo[16];
+  unsigned char hi[16];
+  /* false if the set could not be split into nibble tables */
+  bool nibbles;
+} cmark_simd_byteset;
+
+/** Builds 'set' from 'member', whose non-zero entries are the bytes to
+ * search for.
+ */
+void cmark_simd_byteset_init(cmark_simd_byteset *set, const int8_t *member);
+
+/** Returns a pointer to the first byte in ['p', 'end') that belongs to
+ * 'set', or 'end' if there is none.
+ */
+const unsigned char *cmark_simd_find_set(const unsigned char *p,
+                                         const unsigned char *end,
+                                         const cmark_simd_byteset *set);
+
+/** Returns a pointer to the end of a prefix of ['p', 'end') that is
+ * valid UTF-8 and has no NUL bytes.  The prefix ends at a character
+ * boundary, but may stop short of the first invalid sequence: the bytes
+ * after it have to be checked one character at a time.  Without byte
+ * shuffles, only runs of ASCII are skipped.
+ */
+const unsigned char *cmark_simd_skip_valid_utf8(const unsigned char *p,
+                                                const unsigned char *end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -143,6 +143,16 @@ void cmark_syntax_extension_set_opaque_free_func(cmark_syntax_extension *extensi
   extension->opaque_free_func = func;
 }
 
+void cmark_syntax_extension_set_opaque_serialize_func(cmark_syntax_extension *extension,
+                                                      cmark_opaque_serialize_func func) {
+  extension->opaque_serialize_func = func;
+}
+
+void cmark_syntax_extension_set_opaque_deserialize_func(cmark_syntax_extension *extension,
+                                                        cmark_opaque_deserialize_func func) {
+  extension->opaque_deserialize_func = func;
+}
+
 void cmark_syntax_extension_set_commonmark_escape_func(cmark_syntax_extension *extension,
                                                        cmark_commonmark_escape_func func) {
   extension->commonmark_escape_func = func;
@@ -1,9 +1,11 @@
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
 #include "cmark_ctype.h"
 #include "utf8.h"
+#include "simd.h"
 
 static const int8_t utf8proc_utf8class[256] = {
     1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
@@ -107,44 +109,47 @@ static int utf8proc_valid(const uint8_t *str, bufsize_t str_len) {
   return length;
 }
 
+// How far past the end of a vector scan to check byte by byte before
+// scanning again: enough to get past the block that stopped it.
+#define UTF8_CHECK_STRIDE 64
+
 void cmark_utf8proc_check(cmark_strbuf *ob, const uint8_t *line,
                           bufsize_t size) {
-  bufsize_t i = 0;
+  bufsize_t i = 0, org = 0, stop;
+  int charlen;
 
   while (i < size) {
-    bufsize_t org = i;
-    int charlen = 0;
+    i = (bufsize_t)(cmark_simd_skip_valid_utf8(line + i, line + size) - line);
+    stop = size - i > UTF8_CHECK_STRIDE ? i + UTF8_CHECK_STRIDE : size;
 
-    while (i < size) {
+    while (i < stop) {
       if (line[i] < 0x80 && line[i] != 0) {
         i++;
-      } else if (line[i] >= 0x80) {
-        charlen = utf8proc_valid(line + i, size - i);
-        if (charlen < 0) {
-          charlen = -charlen;
-          break;
-        }
-        i += charlen;
-      } else if (line[i] == 0) {
+        continue;
+      }
+
+      if (line[i] == 0) {
         // ASCII NUL is technically valid but rejected
         // for security reasons.
-        charlen = 1;
-        break;
+        charlen = -1;
+      } else {
+        charlen = utf8proc_valid(line + i, size - i);
       }
-    }
 
-    if (i > org) {
-      cmark_strbuf_put(ob, line + org, i - org);
-    }
+      if (charlen > 0) {
+        i += charlen;
+        continue;
+      }
 
-    if (i >= size) {
-      break;
-    } else {
       // Invalid UTF-8
+      cmark_strbuf_put(ob, line + org, i - org);
       encode_unknown(ob);
-      i += charlen;
+      i -= charlen;
+      org = i;
     }
   }
+
+  cmark_strbuf_put(ob, line + org, size - org);
 }
 
 int cmark_utf8proc_iterate(const uint8_t *str, bufsize_t str_len,
@@ -224,25 +229,98 @@ void cmark_utf8proc_encode_char(int32_t uc, cmark_strbuf *buf) {
   cmark_strbuf_put(buf, dst, len);
 }
 
+// Lowercase the run of ASCII bytes at the start of 'str', eight at a time
+// where possible.  Returns the length of the run.
+static bufsize_t case_fold_ascii(cmark_strbuf *dest, const uint8_t *str,
+                                 bufsize_t len) {
+  uint8_t out[32];
+  bufsize_t i = 0;
+
+  while (i < len) {
+    bufsize_t n = 0;
+
+    while (n + 8 <= (bufsize_t)sizeof(out) && len - i - n >= 8) {
+      uint64_t w;
+
+      memcpy(&w, str + i + n, 8);
+      if (w & 0x8080808080808080ULL)
+        break;
+      // High bit of each byte set for 'A'..'Z', moved to 0x20.
+      w |= ((w + 0x3F3F3F3F3F3F3F3FULL) & ~(w + 0x2525252525252525ULL) &
+            0x8080808080808080ULL) >> 2;
+      memcpy(out + n, &w, 8);
+      n += 8;
+    }
+
+    while (n < (bufsize_t)sizeof(out) && i + n < len && str[i + n] < 0x80) {
+      uint8_t c = str[i + n];
+      out[n++] = c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    }
+
+    cmark_strbuf_put(dest, out, n);
+    i += n;
+    if (n < (bufsize_t)sizeof(out))
+      break;
+  }
+
+  return i;
+}
+
+#include "case_fold.inc"
+
 void cmark_utf8proc_case_fold(cmark_strbuf *dest, const uint8_t *str,
                               bufsize_t len) {
+  bufsize_t i = 0, org = 0;
   int32_t c;
 
-#define bufpush(x) cmark_utf8proc_encode_char(x, dest)
+  // Characters that fold to themselves are copied in runs from 'org'.
+  while (i < len) {
+    bufsize_t char_len;
+    uint32_t fold = 0;
 
-  while (len > 0) {
-    bufsize_t char_len = cmark_utf8proc_iterate(str, len, &c);
+    if (str[i] < 0x80) {
+      cmark_strbuf_put(dest, str + org, i - org);
+      i += case_fold_ascii(dest, str + i, len - i);
+      org = i;
+      continue;
+    }
 
-    if (char_len >= 0) {
-#include "case_fold_switch.inc"
-    } else {
+    char_len = cmark_utf8proc_iterate(str + i, len - i, &c);
+    if (char_len < 0) {
+      cmark_strbuf_put(dest, str + org, i - org);
       encode_unknown(dest);
-      char_len = -char_len;
+      i -= char_len;
+      org = i;
+      continue;
+    }
+
+    if (c < CMARK_CASE_FOLD_LIMIT) {
+      int32_t block = c >> CMARK_CASE_FOLD_SHIFT;
+      int32_t offset = c & ((1 << CMARK_CASE_FOLD_SHIFT) - 1);
+      fold = cmark_case_fold_rows[cmark_case_fold_index[block]][offset];
+    }
+
+    if (fold == 0) {
+      i += char_len;
+      continue;
     }
 
-    str += char_len;
-    len -= char_len;
+    cmark_strbuf_put(dest, str + org, i - org);
+    if (fold & CMARK_CASE_FOLD_MULTI) {
+      const uint32_t *multi =
+          cmark_case_fold_multi[fold & ~CMARK_CASE_FOLD_MULTI];
+      int j;
+
+      for (j = 0; j < 3 && multi[j]; ++j)
+        cmark_utf8proc_encode_char((int32_t)multi[j], dest);
+    } else {
+      cmark_utf8proc_encode_char((int32_t)fold, dest);
+    }
+    i += char_len;
+    org = i;
   }
+
+  cmark_strbuf_put(dest, str + org, i - org);
 }
 
 // matches anything in the Zs class, plus LF, CR, TAB, FF.
@@ -8,10 +8,9 @@
 #include "node.h"
 #include "buffer.h"
 #include "houdini.h"
+#include "render.h"
 #include "syntax_extension.h"
 
-#define BUFFER_SIZE 100
-
 // Functions to convert cmark_nodes to XML strings.
 
 static void escape_xml(cmark_strbuf *dest, const unsigned char *source,
@@ -37,7 +36,6 @@ static int S_render_node(cmark_node *node, cmark_event_type ev_type,
   bool literal = false;
   cmark_delim_type delim;
   bool entering = (ev_type == CMARK_EVENT_ENTER);
-  char buffer[BUFFER_SIZE];
 
   if (entering) {
     indent(state);
@@ -45,10 +43,15 @@ static int S_render_node(cmark_node *node, cmark_event_type ev_type,
     cmark_strbuf_puts(xml, cmark_node_get_type_string(node));
 
     if (options & CMARK_OPT_SOURCEPOS && node->start_line != 0) {
-      snprintf(buffer, BUFFER_SIZE, " sourcepos=\"%d:%d-%d:%d\"",
-               node->start_line, node->start_column, node->end_line,
-               node->end_column);
-      cmark_strbuf_puts(xml, buffer);
+      cmark_strbuf_puts(xml, " sourcepos=\"");
+      cmark_strbuf_put_int(xml, node->start_line);
+      cmark_strbuf_putc(xml, ':');
+      cmark_strbuf_put_int(xml, node->start_column);
+      cmark_strbuf_putc(xml, '-');
+      cmark_strbuf_put_int(xml, node->end_line);
+      cmark_strbuf_putc(xml, ':');
+      cmark_strbuf_put_int(xml, node->end_column);
+      cmark_strbuf_putc(xml, '"');
     }
 
     if (node->extension && node->extension->xml_attr_func) {
@@ -77,9 +80,9 @@ static int S_render_node(cmark_node *node, cmark_event_type ev_type,
       switch (cmark_node_get_list_type(node)) {
       case CMARK_ORDERED_LIST:
         cmark_strbuf_puts(xml, " type=\"ordered\"");
-        snprintf(buffer, BUFFER_SIZE, " start=\"%d\"",
-                 cmark_node_get_list_start(node));
-        cmark_strbuf_puts(xml, buffer);
+        cmark_strbuf_puts(xml, " start=\"");
+        cmark_strbuf_put_int(xml, cmark_node_get_list_start(node));
+        cmark_strbuf_putc(xml, '"');
         delim = cmark_node_get_list_delim(node);
         if (delim == CMARK_PAREN_DELIM) {
           cmark_strbuf_puts(xml, " delim=\"paren\"");
@@ -93,13 +96,14 @@ static int S_render_node(cmark_node *node, cmark_event_type ev_type,
       default:
         break;
       }
-      snprintf(buffer, BUFFER_SIZE, " tight=\"%s\"",
-               (cmark_node_get_list_tight(node) ? "true" : "false"));
-      cmark_strbuf_puts(xml, buffer);
+      cmark_strbuf_puts(xml, cmark_node_get_list_tight(node)
+                                 ? " tight=\"true\""
+                                 : " tight=\"false\"");
       break;
     case CMARK_NODE_HEADING:
-      snprintf(buffer, BUFFER_SIZE, " level=\"%d\"", node->as.heading.level);
-      cmark_strbuf_puts(xml, buffer);
+      cmark_strbuf_puts(xml, " level=\"");
+      cmark_strbuf_put_int(xml, node->as.heading.level);
+      cmark_strbuf_putc(xml, '"');
       break;
     case CMARK_NODE_CODE_BLOCK:
       if (node->as.code.info.len > 0) {
@@ -158,24 +162,43 @@ char *cmark_render_xml(cmark_node *root, int options) {
   return cmark_render_xml_with_mem(root, options, cmark_node_mem(root));
 }
 
-char *cmark_render_xml_with_mem(cmark_node *root, int options, cmark_mem *mem) {
-  char *result;
-  cmark_strbuf xml = CMARK_BUF_INIT(mem);
+static int S_render_xml(cmark_strbuf *xml, cmark_node *root, int options,
+                        cmark_sink *sink) {
   cmark_event_type ev_type;
   cmark_node *cur;
-  struct render_state state = {&xml, 0};
+  struct render_state state = {xml, 0};
+  int status = 0;
 
   cmark_iter *iter = cmark_iter_new(root);
 
   cmark_strbuf_puts(state.xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
   cmark_strbuf_puts(state.xml,
                     "<!DOCTYPE document SYSTEM \"CommonMark.dtd\">\n");
-  while ((ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
+  while (!status && (ev_type = cmark_iter_next(iter)) != CMARK_EVENT_DONE) {
     cur = cmark_iter_get_node(iter);
     S_render_node(cur, ev_type, &state, options);
+    if (sink && cmark_sink_ready(sink, xml))
+      cmark_sink_drain(sink, xml, xml->size, &status);
   }
-  result = (char *)cmark_strbuf_detach(&xml);
+  if (sink)
+    cmark_sink_drain(sink, xml, xml->size, &status);
 
   cmark_iter_free(iter);
-  return result;
+  return status;
+}
+
+char *cmark_render_xml_with_mem(cmark_node *root, int options, cmark_mem *mem) {
+  cmark_strbuf xml = CMARK_BUF_INIT(mem);
+
+  S_render_xml(&xml, root, options, NULL);
+  return (char *)cmark_strbuf_detach(&xml);
+}
+
+int cmark_render_xml_to_sink(cmark_node *root, int options, cmark_sink *sink) {
+  cmark_strbuf xml = CMARK_BUF_INIT(cmark_node_mem(root));
+  int status;
+
+  status = S_render_xml(&xml, root, options, sink);
+  cmark_strbuf_free(&xml);
+  return status;
 }
@@ -1,4 +1,4 @@
-# Creates C data structures for binary lookup table of entities,
+# Creates C data structures for a perfect hash table of entities,
 # using python's html5 entity data.
 # Usage: python3 tools/make_entities_inc.py > src/entities.inc
 
@@ -11,8 +11,49 @@ entities5 = html.entities.html5
 # without a semicolon.
 entities = sorted([(k[:-1], entities5[k].encode('utf-8')) for k in entities5.keys() if k[-1] == ';'])
 
+# The table is a minimal perfect hash, built by "hash and displace":
+# every name is hashed (with seed 0) into one of a few buckets, and each
+# bucket gets a seed that sends all of its names to free slots.  Looking
+# a name up takes two hashes and a single comparison.  entity_hash()
+# must match S_entity_hash() in src/houdini_html_u.c.
+NAMES_PER_BUCKET = 4
+
+def entity_hash(seed, name):
+    h = 2166136261 ^ seed
+    for c in name:
+        h = ((h ^ c) * 16777619) & 0xffffffff
+    return h
+
+num_slots = len(entities)
+num_buckets = num_slots // NAMES_PER_BUCKET + 1
+
+buckets = [[] for _ in range(num_buckets)]
+for (ent, bs) in entities:
+    name = ent.encode('ascii')
+    buckets[entity_hash(0, name) % num_buckets].append((ent, bs))
+
+slots = [None] * num_slots
+seeds = [0] * num_buckets
+
+# Place the fullest buckets first, while there is most room.
+for b in sorted(range(num_buckets), key=lambda b: -len(buckets[b])):
+    if not buckets[b]:
+        continue
+    seed = 1
+    while True:
+        taken = [entity_hash(seed, ent.encode('ascii')) % num_slots
+                 for (ent, bs) in buckets[b]]
+        if len(set(taken)) == len(taken) and \
+           all(slots[s] is None for s in taken):
+            break
+        seed += 1
+    assert seed < 65536
+    for (s, entry) in zip(taken, buckets[b]):
+        slots[s] = entry
+    seeds[b] = seed
+
 # Print out the header:
-print("""/* Autogenerated by tools/make_headers_inc.py */
+print("""/* Autogenerated by tools/make_entities_inc.py */
 
 struct cmark_entity_node {
 	unsigned char *entity;
@@ -22,11 +63,19 @@ struct cmark_entity_node {
 #define CMARK_ENTITY_MIN_LENGTH 2
 #define CMARK_ENTITY_MAX_LENGTH 32""")
 
-print("#define CMARK_NUM_ENTITIES " + str(len(entities)));
+print("#define CMARK_NUM_ENTITIES " + str(num_slots));
+print("#define CMARK_ENTITY_BUCKETS " + str(num_buckets));
+
+print("\nstatic const uint16_t cmark_entity_seeds[] = {")
+
+for i in range(0, num_buckets, 12):
+  print(', '.join(map(str, seeds[i:i + 12])) + ',')
+
+print("};")
 
 print("\nstatic const struct cmark_entity_node cmark_entities[] = {");
 
-for (ent, bs) in entities:
+for (ent, bs) in slots:
   print('{(unsigned char*)"' + ent + '", {' + ', '.join(map(str, bs)) + ', 0}},')
 
 print("};")
@@ -1,22 +1,86 @@
 binmode STDOUT;
-print("    switch (c) {\n");
-my $lastchar = "";
+
+# Reads CaseFolding.txt and prints a two-level lookup table for the
+# common (C) and full (F) case foldings.  A code point's block (its
+# value shifted right by $shift) selects a row of folds through the
+# index; identical rows, including the all-identity row 0, are shared.
+# A row entry is 0 if the code point folds to itself, the folded code
+# point, or CMARK_CASE_FOLD_MULTI plus an index into the table of
+# foldings to more than one code point.
+my $shift = 7;
+my $row_size = 1 << $shift;
+
+my %fold;
 while (<STDIN>) {
   if (/^[A-F0-9]/ and / [CF]; /) {
     my ($char, $type, $subst) = m/([A-F0-9]+); ([CF]); ([^;]+)/;
-    if ($char eq $lastchar) {
-      break;
-    }
-    my @subst = $subst =~ m/(\w+)/g;
-    printf("      case 0x%s:\n", $char);
-    foreach (@subst) {
-      printf("        bufpush(0x%s);\n", $_);
+    my $c = hex($char);
+    next if exists $fold{$c};
+    $fold{$c} = [map { hex($_) } $subst =~ m/(\w+)/g];
+  }
+}
+
+my $max = 0;
+foreach (keys %fold) {
+  $max = $_ if $_ > $max;
+}
+my $num_blocks = ($max >> $shift) + 1;
+
+my @multi;
+my @rows = (join(',', (0) x $row_size));
+my %row_index = ($rows[0] => 0);
+my @index;
+
+for (my $b = 0; $b < $num_blocks; $b++) {
+  my @row;
+  for (my $i = 0; $i < $row_size; $i++) {
+    my $subst = $fold{($b << $shift) + $i};
+    if (!defined $subst) {
+      push(@row, 0);
+    } elsif (@$subst == 1) {
+      push(@row, sprintf("0x%04X", $subst->[0]));
+    } else {
+      push(@row, sprintf("CMARK_CASE_FOLD_MULTI + %d", scalar(@multi)));
+      push(@multi, $subst);
     }
-    printf("        break;\n");
-    $lastchar = $char;
   }
+  my $key = join(',', @row);
+  if (!exists $row_index{$key}) {
+    $row_index{$key} = scalar(@rows);
+    push(@rows, $key);
+  }
+  push(@index, $row_index{$key});
+}
+
+die "too many rows" if @rows > 256;
+
+print("/* Autogenerated by tools/mkcasefold.pl */\n\n");
+printf("#define CMARK_CASE_FOLD_SHIFT %d\n", $shift);
+printf("#define CMARK_CASE_FOLD_LIMIT 0x%X\n", $num_blocks << $shift);
+print("#define CMARK_CASE_FOLD_MULTI 0x80000000u\n");
+
+print("\nstatic const uint8_t cmark_case_fold_index[] = {\n");
+for (my $i = 0; $i < @index; $i += 16) {
+  my $end = $i + 15 < $#index ? $i + 15 : $#index;
+  print("    " . join(', ', @index[$i .. $end]) . ",\n");
 }
-printf("      default:\n");
-printf("        bufpush(c);\n");
-print("    }\n");
+print("};\n");
 
+printf("\nstatic const uint32_t cmark_case_fold_rows[][%d] = {\n", $row_size);
+foreach my $row (@rows) {
+  my @entries = split(',', $row);
+  print("    {\n");
+  for (my $i = 0; $i < @entries; $i += 8) {
+    print("        " . join(', ', @entries[$i .. $i + 7]) . ",\n");
+  }
+  print("    },\n");
+}
+print("};\n");
+
+print("\nstatic const uint32_t cmark_case_fold_multi[][3] = {\n");
+foreach my $subst (@multi) {
+  my @cps = map { sprintf("0x%04X", $_) } @$subst;
+  push(@cps, 0) while @cps < 3;
+  print("    {" . join(', ', @cps) . "},\n");
+}
+print("};\n");